@@ -0,0 +1,238 @@
+#include "BeirReader.h"
+using namespace std;
+
+
+size_t BeirReader::_skipSpace(const string &line, size_t pos) {
+    while (pos < line.size() && isspace((unsigned char)line[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+
+// Encodes a unicode code point as UTF-8
+void BeirReader::_appendUtf8(string &out, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        out += (char)codePoint;
+    }
+    else if (codePoint < 0x800) {
+        out += (char)(0xC0 | (codePoint >> 6));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000) {
+        out += (char)(0xE0 | (codePoint >> 12));
+        out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else {
+        out += (char)(0xF0 | (codePoint >> 18));
+        out += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+        out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+}
+
+
+bool BeirReader::_parseHex4(const string &line, size_t pos, uint32_t &value) {
+    if (pos + 4 > line.size()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = pos; i < pos + 4; i++) {
+        if (!isxdigit((unsigned char)line[i])) {
+            return false;
+        }
+        value = value * 16 + (isdigit((unsigned char)line[i]) ? line[i] - '0' : tolower((unsigned char)line[i]) - 'a' + 10);
+    }
+    return true;
+}
+
+
+// Parses a JSON string starting at the opening quote, resolving escapes (including \uXXXX surrogate pairs)
+size_t BeirReader::_parseString(const string &line, size_t pos, string &value) {
+    value.clear();
+    pos++;  // skip the opening quote
+    while (pos < line.size() && line[pos] != '"') {
+        if (line[pos] != '\\') {
+            value += line[pos++];
+            continue;
+        }
+        pos++;
+        if (pos >= line.size()) {
+            break;
+        }
+        char esc = line[pos++];
+        switch (esc) {
+            case 'n': value += '\n'; break;
+            case 't': value += '\t'; break;
+            case 'r': value += '\r'; break;
+            case 'b': value += '\b'; break;
+            case 'f': value += '\f'; break;
+            case 'u': {
+                // A malformed escape becomes U+FFFD, and the characters after "\u" are read as text
+                uint32_t codePoint;
+                if (!_parseHex4(line, pos, codePoint)) {
+                    _appendUtf8(value, 0xFFFD);
+                    break;
+                }
+                pos += 4;
+                // Combine a UTF-16 surrogate pair into one code point; a lone surrogate is not a character
+                uint32_t low;
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF && pos + 2 <= line.size()
+                    && line[pos] == '\\' && line[pos + 1] == 'u' && _parseHex4(line, pos + 2, low)
+                    && low >= 0xDC00 && low <= 0xDFFF) {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                }
+                _appendUtf8(value, codePoint >= 0xD800 && codePoint <= 0xDFFF ? 0xFFFD : codePoint);
+                break;
+            }
+            default: value += esc; break;  // \" \\ \/
+        }
+    }
+    return pos + 1;  // skip the closing quote
+}
+
+
+// Skips any JSON value that is not needed, tracking nesting depth and strings inside it
+size_t BeirReader::_skipValue(const string &line, size_t pos) {
+    int depth = 0;
+    string ignored;
+    while (pos < line.size()) {
+        char ch = line[pos];
+        if (ch == '"') {
+            pos = _parseString(line, pos, ignored);
+            if (depth == 0) {
+                return pos;
+            }
+            continue;
+        }
+        if (ch == '{' || ch == '[') {
+            depth++;
+        }
+        else if (ch == '}' || ch == ']') {
+            if (depth == 0) {
+                return pos;  // end of the enclosing object
+            }
+            depth--;
+            if (depth == 0) {
+                return pos + 1;
+            }
+        }
+        else if (ch == ',' && depth == 0) {
+            return pos;
+        }
+        pos++;
+    }
+    return pos;
+}
+
+
+// Parses one JSON line into its top-level string fields; returns false on malformed input
+bool BeirReader::parseLine(const string &line, map<string, string> &fields) {
+    fields.clear();
+    size_t pos = _skipSpace(line, 0);
+    if (pos >= line.size() || line[pos] != '{') {
+        return false;
+    }
+    pos++;
+
+    while (true) {
+        pos = _skipSpace(line, pos);
+        if (pos >= line.size()) {
+            return false;
+        }
+        if (line[pos] == '}') {
+            return true;
+        }
+        if (line[pos] != '"') {
+            return false;
+        }
+
+        string key;
+        pos = _parseString(line, pos, key);
+        pos = _skipSpace(line, pos);
+        if (pos >= line.size() || line[pos] != ':') {
+            return false;
+        }
+        pos = _skipSpace(line, pos + 1);
+        if (pos >= line.size()) {
+            return false;
+        }
+
+        if (line[pos] == '"') {
+            string value;
+            pos = _parseString(line, pos, value);
+            fields[key] = value;
+        }
+        else {
+            pos = _skipValue(line, pos);
+        }
+
+        pos = _skipSpace(line, pos);
+        if (pos < line.size() && line[pos] == ',') {
+            pos++;
+        }
+    }
+}
+
+
+// BEIR documents carry an optional title; index it together with the body text
+string BeirReader::getDocumentText(const map<string, string> &fields) {
+    string text;
+    auto title = fields.find("title");
+    if (title != fields.end() && !title->second.empty()) {
+        text = title->second + " ";
+    }
+    auto body = fields.find("text");
+    if (body != fields.end()) {
+        text += body->second;
+    }
+    return text;
+}
+
+
+void BeirReader::loadQueries(const string &path, vector<pair<string, string>> &queries) {
+    ifstream infile(path);
+    if (!infile.is_open()) {
+        cerr << "Error opening queries file: " << path << endl;
+        return;
+    }
+    queries.clear();
+
+    string line;
+    map<string, string> fields;
+    while (getline(infile, line)) {
+        if (!parseLine(line, fields) || !fields.count("_id")) {
+            cerr << "Invalid query line: " << line << endl;
+            continue;
+        }
+        queries.emplace_back(fields["_id"], fields["text"]);
+    }
+    cout << "Loaded " << queries.size() << " queries from " << path << endl;
+}
+
+
+// Reads BEIR qrels: a "query-id corpus-id score" TSV with a header line
+void BeirReader::loadQrels(const string &path, map<string, map<string, int>> &qrels) {
+    ifstream infile(path);
+    if (!infile.is_open()) {
+        cerr << "Error opening qrels file: " << path << endl;
+        return;
+    }
+    qrels.clear();
+
+    string line;
+    while (getline(infile, line)) {
+        istringstream iss(line);
+        string queryId, corpusId, scoreStr;
+        if (!(iss >> queryId >> corpusId >> scoreStr)) {
+            continue;
+        }
+        if (!isdigit((unsigned char)scoreStr[0]) && scoreStr[0] != '-') {
+            continue;  // header line
+        }
+        qrels[queryId][corpusId] = stoi(scoreStr);
+    }
+    cout << "Loaded qrels of " << qrels.size() << " queries from " << path << endl;
+}
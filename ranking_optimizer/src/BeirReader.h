@@ -0,0 +1,28 @@
+#ifndef SEARCHSYSTEM_BEIRREADER_H
+#define SEARCHSYSTEM_BEIRREADER_H
+
+#include "config.h"
+#include <string>
+#include <vector>
+#include <map>
+using namespace std;
+
+
+// Reader for BEIR datasets (corpus.jsonl, queries.jsonl, qrels/*.tsv).
+// Only top-level string fields of a JSON line are extracted; nested values such as "metadata" are skipped.
+class BeirReader {
+private:
+    static size_t _skipSpace(const string &line, size_t pos);
+    static size_t _parseString(const string &line, size_t pos, string &value);  // returns position after the closing quote
+    static size_t _skipValue(const string &line, size_t pos);  // skip a number, literal, object or array
+    static void _appendUtf8(string &out, uint32_t codePoint);
+    static bool _parseHex4(const string &line, size_t pos, uint32_t &value);  // false unless 4 hex digits are at pos
+
+public:
+    static bool parseLine(const string &line, map<string, string> &fields);  // top-level string fields of one JSON object
+    static string getDocumentText(const map<string, string> &fields);  // title and text joined for indexing
+    static void loadQueries(const string &path, vector<pair<string, string>> &queries);  // (query id, query text)
+    static void loadQrels(const string &path, map<string, map<string, int>> &qrels);  // query id -> (corpus id -> relevance)
+};
+
+#endif //SEARCHSYSTEM_BEIRREADER_H
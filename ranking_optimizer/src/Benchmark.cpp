@@ -0,0 +1,275 @@
+#include "Benchmark.h"
+#include <iomanip>
+#include <numeric>  // For accumulate and partial_sum
+using namespace std;
+
+
+Benchmark::Benchmark(Lexicon &lexicon) : _lexicon(lexicon) {
+}
+
+
+Benchmark::~Benchmark() = default;
+
+
+bool Benchmark::_loadIndex() {
+    if (!_indexData.empty()) {
+        return true;
+    }
+    ifstream infile(_lexicon.indexPath, ifstream::binary | ifstream::ate);
+    if (!infile.is_open()) {
+        cerr << "Error opening index file: " << _lexicon.indexPath << endl;
+        return false;
+    }
+    _indexData.resize(infile.tellg());
+    infile.seekg(0);
+    infile.read(reinterpret_cast<char *>(_indexData.data()), _indexData.size());
+    return true;
+}
+
+
+// Walks the block metadata of every term and records where each docID and freq chunk lives
+void Benchmark::_collectChunks() {
+    _chunkList.clear();
+    _chunkCodecList.clear();
+    for (uint64_t termIdx = 0; termIdx < _lexicon.size(); termIdx++) {
+        LexiconItem lexItem = _lexicon.itemAt(termIdx);
+        uint64_t pos = lexItem.beginPos;
+        for (uint32_t block = 0; block < lexItem.blockNum; block++) {
+            uint32_t metadataSize;
+            memcpy(&metadataSize, &_indexData[pos], sizeof(uint32_t));
+            const uint8_t *docIdSizes = &_indexData[pos + 4 + 4 * metadataSize];
+            const uint8_t *freqSizes = &_indexData[pos + 4 + 8 * metadataSize];
+            uint64_t dataPos = pos + 4 + 12 * metadataSize;
+
+            for (uint32_t i = 0; i < metadataSize; i++) {
+                uint32_t docIdSize, freqSize;
+                memcpy(&docIdSize, docIdSizes + 4 * i, sizeof(uint32_t));
+                memcpy(&freqSize, freqSizes + 4 * i, sizeof(uint32_t));
+                _chunkList.emplace_back(dataPos, docIdSize);
+                _chunkList.emplace_back(dataPos + docIdSize, freqSize);
+                _chunkCodecList.push_back(chunkCodec(lexItem.codec, true));
+                _chunkCodecList.push_back(chunkCodec(lexItem.codec, false));
+                dataPos += docIdSize + freqSize;
+            }
+            pos = dataPos;
+        }
+    }
+}
+
+
+// Decodes every varbyte chunk of the index with both decoders, checks that they agree and reports throughput
+void Benchmark::varbyteDecode() {
+    if (!_loadIndex()) {
+        return;
+    }
+    _collectChunks();
+
+    // Only the varbyte chunks of the index take part
+    vector<pair<uint64_t, uint32_t>> varbyteChunkList;
+    for (size_t i = 0; i < _chunkList.size(); i++) {
+        if (_chunkCodecList[i] == CODEC_VARBYTE) {
+            varbyteChunkList.push_back(_chunkList[i]);
+        }
+    }
+    if (varbyteChunkList.empty()) {
+        cout << "Varbyte decoding benchmark skipped: the index has no varbyte chunks" << endl;
+        return;
+    }
+
+    vector<uint32_t> scalarOut, simdOut;
+    uint64_t totalBytes = 0;
+    for (const auto& [offset, size] : varbyteChunkList) {
+        totalBytes += size;
+    }
+    cout << "Varbyte decoding benchmark: " << varbyteChunkList.size() << " chunks, "
+         << totalBytes / 1024 << " KB, SIMD " << (varbyteHasSIMD() ? "enabled" : "not available") << endl;
+
+    // Correctness check first
+    for (const auto& [offset, size] : varbyteChunkList) {
+        scalarOut.resize(size);
+        simdOut.resize(size);
+        size_t scalarNum = varbyteDecodeScalar(&_indexData[offset], size, scalarOut.data());
+        size_t simdNum = varbyteDecodeSIMD(&_indexData[offset], size, simdOut.data());
+        if (scalarNum != simdNum || !equal(scalarOut.begin(), scalarOut.begin() + scalarNum, simdOut.begin())) {
+            cerr << "SIMD varbyte decoder disagrees with the scalar decoder at offset " << offset << endl;
+            return;
+        }
+    }
+
+    vector<uint32_t> out(POSTINGS_PER_CHUNK * 5);
+    auto run = [&](size_t (*decode)(const uint8_t *, size_t, uint32_t *)) {
+        uint64_t intNum = 0;
+        uint32_t rounds = 0;
+        auto begin = chrono::steady_clock::now();
+        double seconds = 0;
+        do {
+            for (const auto& [offset, size] : varbyteChunkList) {
+                intNum += decode(&_indexData[offset], size, out.data());
+            }
+            rounds += 1;
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        } while (seconds < BENCHMARK_MIN_SECONDS);
+        return make_pair(intNum / seconds, rounds);
+    };
+
+    auto [scalarRate, scalarRounds] = run(varbyteDecodeScalar);
+    auto [simdRate, simdRounds] = run(varbyteDecodeSIMD);
+    cout << fixed << setprecision(1);
+    cout << "  scalar: " << scalarRate / 1e6 << " M ints/s (" << scalarRounds << " rounds)" << endl;
+    cout << "  SIMD:   " << simdRate / 1e6 << " M ints/s (" << simdRounds << " rounds)" << endl;
+    cout << "  speedup: " << setprecision(2) << simdRate / scalarRate << "x" << endl;
+}
+
+
+// Re-encodes every chunk of the index with each codec, then compares their size and decoding speed
+void Benchmark::compareCodecs() {
+    if (!_loadIndex()) {
+        return;
+    }
+    _collectChunks();
+
+    // Raw integers of every chunk, decoded with the codec the index was built with
+    // (_chunkList alternates docID and frequency chunks)
+    vector<vector<uint32_t>> rawChunks;
+    vector<uint32_t> out(POSTINGS_PER_CHUNK * 5);
+    uint64_t intNum = 0;
+    for (size_t i = 0; i < _chunkList.size(); i++) {
+        auto [offset, size] = _chunkList[i];
+        out.resize(max<size_t>(size, POSTINGS_PER_CHUNK));
+        size_t num = decodeChunk(_chunkCodecList[i], &_indexData[offset], size, out.data());
+        if (i % 2 == 1 && size == 0) {
+            num = rawChunks.back().size();  // all-ones frequency chunk
+            fill(out.begin(), out.begin() + num, 1);
+        }
+        rawChunks.emplace_back(out.begin(), out.begin() + num);
+        intNum += num;
+    }
+
+    vector<uint8_t> varbyteData, pforData, efData;
+    vector<pair<uint32_t, uint32_t>> varbyteChunks, pforChunks, efChunks;
+    uint64_t varbyteDocIdBytes = 0, pforDocIdBytes = 0;
+    uint64_t varbyteFreqBytes = 0, pforFreqBytes = 0, freqBytes = 0, allOnesNum = 0;
+    for (size_t i = 0; i < rawChunks.size(); i++) {
+        const auto &values = rawChunks[i];
+        size_t begin = varbyteData.size();
+        for (uint32_t value : values) {
+            vector<uint8_t> bytes = varbyteEncode(value);
+            varbyteData.insert(varbyteData.end(), bytes.begin(), bytes.end());
+        }
+        varbyteChunks.emplace_back(begin, varbyteData.size() - begin);
+
+        begin = pforData.size();
+        pforEncode(values.data(), values.size(), pforData);
+        pforChunks.emplace_back(begin, pforData.size() - begin);
+
+        if (i % 2 == 0) {
+            varbyteDocIdBytes += varbyteChunks.back().second;
+            pforDocIdBytes += pforChunks.back().second;
+            begin = efData.size();
+            efEncode(values.data(), values.size(), efData);
+            efChunks.emplace_back(begin, efData.size() - begin);
+        }
+        else {
+            varbyteFreqBytes += varbyteChunks.back().second;
+            pforFreqBytes += pforChunks.back().second;
+            vector<uint8_t> encoded;
+            size_t bytes = encodeChunk(CODEC_FREQ, values.data(), values.size(), encoded);
+            freqBytes += bytes;
+            allOnesNum += (bytes == 0);
+        }
+    }
+
+    // Every codec must give back the same integers
+    out.resize(POSTINGS_PER_CHUNK * 5);
+    for (size_t i = 0; i < rawChunks.size(); i++) {
+        size_t num = pforDecode(&pforData[pforChunks[i].first], pforChunks[i].second, out.data());
+        if (num != rawChunks[i].size() || !equal(rawChunks[i].begin(), rawChunks[i].end(), out.begin())) {
+            cerr << "PFor decoder disagrees with the encoded chunk " << i << endl;
+            return;
+        }
+        if (i % 2 == 0) {
+            num = efDecode(&efData[efChunks[i / 2].first], efChunks[i / 2].second, out.data());
+            if (num != rawChunks[i].size() || !equal(rawChunks[i].begin(), rawChunks[i].end(), out.begin())) {
+                cerr << "Elias-Fano decoder disagrees with the encoded chunk " << i << endl;
+                return;
+            }
+            // Searching the compressed chunk: every docID, the gaps between them and targets past its end
+            EliasFanoChunk chunk;
+            chunk.open(&efData[efChunks[i / 2].first], efChunks[i / 2].second);
+            uint32_t chunkSize = rawChunks[i].size();
+            vector<uint32_t> docIds(chunkSize);
+            partial_sum(rawChunks[i].begin(), rawChunks[i].end(), docIds.begin());
+            bool found = chunk.size() == chunkSize;
+            for (uint32_t k = 0; k < chunkSize && found; k++) {
+                found = chunk.nextGEQ(docIds[k]) == k && chunk.nextGEQ(docIds[k] + 1) == k + 1;
+            }
+            if (!found || (chunkSize && chunk.nextGEQ(UINT32_MAX) != chunkSize)) {
+                cerr << "Elias-Fano nextGEQ disagrees with the encoded chunk " << i << endl;
+                return;
+            }
+        }
+    }
+
+    auto run = [&](const vector<uint8_t> &data, const vector<pair<uint32_t, uint32_t>> &chunks,
+                   size_t (*decode)(const uint8_t *, size_t, uint32_t *)) {
+        uint64_t decodedNum = 0;
+        auto begin = chrono::steady_clock::now();
+        double seconds = 0;
+        do {
+            for (const auto& [offset, size] : chunks) {
+                decodedNum += decode(&data[offset], size, out.data());
+            }
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        } while (seconds < BENCHMARK_MIN_SECONDS);
+        return decodedNum / seconds;
+    };
+
+    double varbyteRate = run(varbyteData, varbyteChunks, varbyteDecodeSIMD);
+    double pforRate = run(pforData, pforChunks, pforDecode);
+    double efRate = run(efData, efChunks, efDecode);
+    cout << "Codec comparison: " << rawChunks.size() << " chunks, " << intNum << " integers" << endl;
+    cout << fixed << setprecision(2);
+    cout << "  varbyte: " << varbyteData.size() / 1024 << " KB, " << 8.0 * varbyteData.size() / intNum
+         << " bits/int, " << setprecision(1) << varbyteRate / 1e6 << " M ints/s" << endl;
+    cout << setprecision(2);
+    cout << "  PFor:    " << pforData.size() / 1024 << " KB, " << 8.0 * pforData.size() / intNum
+         << " bits/int, " << setprecision(1) << pforRate / 1e6 << " M ints/s" << endl;
+    cout << "  docID chunks only: varbyte " << varbyteDocIdBytes / 1024 << " KB, PFor " << pforDocIdBytes / 1024
+         << " KB, Elias-Fano " << efData.size() / 1024 << " KB (" << efRate / 1e6 << " M ints/s)" << endl;
+    cout << "  freq chunks only: varbyte " << varbyteFreqBytes / 1024 << " KB, PFor " << pforFreqBytes / 1024
+         << " KB, freq codec " << freqBytes / 1024 << " KB, " << allOnesNum << " of " << rawChunks.size() / 2
+         << " chunks all ones" << endl;
+
+    // Decoding cost of every docID codec, in the units of CODEC_DECODE_NS (PostingCodec.cpp); the bitmap codec
+    // is only timed on the chunks CodecChooser would allow it for
+    cout << "  CODEC_DECODE_NS, ns per docID:";
+    for (uint32_t codec = 0; codec < CODEC_NUM; codec++) {
+        vector<uint8_t> data;
+        vector<pair<uint32_t, uint32_t>> chunks;
+        for (size_t i = 0; i < rawChunks.size(); i += 2) {
+            const auto &gaps = rawChunks[i];
+            uint64_t span = accumulate(gaps.begin() + min<size_t>(1, gaps.size()), gaps.end(), (uint64_t)0);
+            if (codec == CODEC_BITMAP && span / 8 > gaps.size() * sizeof(uint32_t)) {
+                continue;
+            }
+            size_t begin = data.size();
+            encodeChunk(codec, gaps.data(), gaps.size(), data);
+            chunks.emplace_back(begin, data.size() - begin);
+        }
+        if (chunks.empty()) {
+            cout << " " << codecName(codec) << " -";
+            continue;
+        }
+        uint64_t decodedNum = 0;
+        auto begin = chrono::steady_clock::now();
+        double seconds = 0;
+        do {
+            for (const auto& [offset, size] : chunks) {
+                decodedNum += decodeChunk(codec, &data[offset], size, out.data());
+            }
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        } while (seconds < BENCHMARK_MIN_SECONDS);
+        cout << " " << codecName(codec) << " " << setprecision(2) << seconds * 1e9 / decodedNum;
+    }
+    cout << endl;
+}
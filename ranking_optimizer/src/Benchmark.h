@@ -0,0 +1,32 @@
+#ifndef SEARCHSYSTEM_BENCHMARK_H
+#define SEARCHSYSTEM_BENCHMARK_H
+
+#include "config.h"
+#include "Lexicon.h"
+#include "Varbyte.h"
+#include <string>
+#include <vector>
+#include <chrono>
+using namespace std;
+
+
+// Microbenchmarks over the final index, enabled with BENCHMARK_FLAG
+class Benchmark {
+private:
+    Lexicon &_lexicon;
+    vector<uint8_t> _indexData;  // whole index file in memory, so only decoding is timed
+    vector<pair<uint64_t, uint32_t>> _chunkList;  // (offset, byte size) of every docID and freq chunk
+    vector<uint32_t> _chunkCodecList;  // codec of every chunk in _chunkList
+
+    bool _loadIndex();
+    void _collectChunks();
+
+public:
+    explicit Benchmark(Lexicon &lexicon);
+    ~Benchmark();
+
+    void varbyteDecode();  // integers per second of the scalar and SIMD varbyte decoders
+    void compareCodecs();  // size and decoding speed of the varbyte and PFor chunk codecs
+};
+
+#endif //SEARCHSYSTEM_BENCHMARK_H
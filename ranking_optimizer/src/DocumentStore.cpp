@@ -0,0 +1,179 @@
+#include "DocumentStore.h"
+#include "zlib.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+
+DocumentStore::DocumentStore() = default;
+
+
+DocumentStore::~DocumentStore() {
+    _unmap();
+}
+
+
+void DocumentStore::_unmap() {
+    unmapFile(_mapped, _mappedSize);
+    _mapped = nullptr;
+    _mappedSize = 0;
+    _blockList = nullptr;
+    _blockNum = 0;
+    _docOffsetList = nullptr;
+    _cache.clear();
+}
+
+
+bool DocumentStore::create(const string &path) {
+    _path = path;
+    _outfile.open(path, ofstream::binary);
+    if (!_outfile.is_open()) {
+        cerr << "Error opening output file: " << path << endl;
+        return false;
+    }
+    writeHeaderPlaceholder(_outfile);
+    header = newFileHeader(FORMAT_MAGIC_DOC_STORE);
+    beginSection(header, SECTION_DOC_STORE_BLOCKS, _outfile.tellp());
+    _block.clear();
+    _pendingBlocks.clear();
+    _pendingOffsets.clear();
+    return true;
+}
+
+
+void DocumentStore::add(string_view content) {
+    if (!_outfile.is_open()) {
+        return;
+    }
+    bool blockOpen = !_pendingBlocks.empty() && _pendingBlocks.back().compressedSize == 0;
+    if (blockOpen && !_block.empty() && _block.size() + content.size() > DOC_STORE_BLOCK_SIZE) {
+        _flushBlock();
+        blockOpen = false;
+    }
+    if (!blockOpen) {
+        _pendingBlocks.push_back({0, 0, 0, (uint32_t)_pendingOffsets.size(), 0});
+    }
+    _pendingOffsets.push_back(_block.size());
+    _block.append(content);
+}
+
+
+void DocumentStore::_flushBlock() {
+    uLongf compressedSize = compressBound(_block.size());
+    _compressed.resize(compressedSize);
+    compress2(_compressed.data(), &compressedSize, reinterpret_cast<const Bytef *>(_block.data()), _block.size(),
+              Z_DEFAULT_COMPRESSION);
+    BlockEntry &entry = _pendingBlocks.back();
+    entry.offset = _outfile.tellp();
+    entry.compressedSize = compressedSize;
+    entry.rawSize = _block.size();
+    _outfile.write(reinterpret_cast<const char *>(_compressed.data()), compressedSize);
+    _block.clear();
+}
+
+
+void DocumentStore::finish(const FileHeader &pageTableHeader) {
+    if (!_outfile.is_open()) {
+        return;
+    }
+    if (!_pendingBlocks.empty() && _pendingBlocks.back().compressedSize == 0) {
+        _flushBlock();
+    }
+    endSection(header, _outfile.tellp());
+    alignSection(_outfile);
+    beginSection(header, SECTION_DOC_STORE_BLOCK_INDEX, _outfile.tellp());
+    _outfile.write(reinterpret_cast<const char *>(_pendingBlocks.data()), _pendingBlocks.size() * sizeof(BlockEntry));
+    endSection(header, _outfile.tellp());
+    beginSection(header, SECTION_DOC_STORE_OFFSETS, _outfile.tellp());
+    _outfile.write(reinterpret_cast<const char *>(_pendingOffsets.data()), _pendingOffsets.size() * sizeof(uint32_t));
+    endSection(header, _outfile.tellp());
+    _outfile.close();
+
+    header.docNum = _pendingOffsets.size();
+    header.sourceCrc = sourceCrcOf(pageTableHeader);
+    finalizeFile(_path, header);
+    cout << "Document store: " << header.docNum << " documents in " << _pendingBlocks.size() << " blocks, "
+         << header.sectionList[0].size / 1024 << " KB compressed" << endl;
+    _pendingBlocks = vector<BlockEntry>();
+    _pendingOffsets = vector<uint32_t>();
+}
+
+
+void DocumentStore::load(const string &path, const FileHeader &pageTableHeader) {
+    if (!readHeader(path, FORMAT_MAGIC_DOC_STORE, header) || !checkSource(header, pageTableHeader, path, "the page table")) {
+        exit(1);
+    }
+    _unmap();
+    _mapped = mapFile(path, _mappedSize);
+    if (!_mapped) {
+        exit(1);
+    }
+    const FileSection *blocks = findSection(header, SECTION_DOC_STORE_BLOCKS);
+    const FileSection *blockIndex = findSection(header, SECTION_DOC_STORE_BLOCK_INDEX);
+    const FileSection *offsets = findSection(header, SECTION_DOC_STORE_OFFSETS);
+    if (!blocks || !blockIndex || !offsets || blockIndex->offset % 8 != 0 || blockIndex->size % sizeof(BlockEntry) != 0
+        || offsets->size != header.docNum * sizeof(uint32_t)) {
+        cerr << path << ": malformed document store, rebuild it with the page table" << endl;
+        exit(1);
+    }
+    _blockList = reinterpret_cast<const BlockEntry *>(_mapped + blockIndex->offset);
+    _blockNum = blockIndex->size / sizeof(BlockEntry);
+    _docOffsetList = reinterpret_cast<const uint32_t *>(_mapped + offsets->offset);
+    _cache.reserve(DOC_STORE_CACHE_BLOCKS);
+}
+
+
+// Decompressed block, from the cache or the file; the least recently used cached block is replaced
+const string *DocumentStore::_getBlock(uint32_t block) {
+    _useCount += 1;
+    for (CachedBlock &cached : _cache) {
+        if (cached.block == block) {
+            cached.lastUse = _useCount;
+            return &cached.data;
+        }
+    }
+    CachedBlock *slot;
+    if (_cache.size() < DOC_STORE_CACHE_BLOCKS) {
+        _cache.push_back({});
+        slot = &_cache.back();
+    }
+    else {
+        slot = &*min_element(_cache.begin(), _cache.end(), [](const CachedBlock &a, const CachedBlock &b) {
+            return a.lastUse < b.lastUse;
+        });
+    }
+
+    const BlockEntry &entry = _blockList[block];
+    slot->block = block;
+    slot->lastUse = _useCount;
+    slot->data.resize(entry.rawSize);
+    uLongf rawSize = entry.rawSize;
+    if (entry.offset + entry.compressedSize > _mappedSize
+        || uncompress(reinterpret_cast<Bytef *>(&slot->data[0]), &rawSize, _mapped + entry.offset, entry.compressedSize) != Z_OK
+        || rawSize != entry.rawSize) {
+        cerr << "Error decompressing block " << block << " of the document store" << endl;
+        slot->block = UINT32_MAX;
+        return nullptr;
+    }
+    return &slot->data;
+}
+
+
+string DocumentStore::get(uint32_t docIndex) {
+    if (!_blockList || docIndex >= header.docNum) {
+        return "";
+    }
+    // Last block whose first document is not after docIndex
+    const BlockEntry *entry = upper_bound(_blockList, _blockList + _blockNum, docIndex,
+                                          [](uint32_t doc, const BlockEntry &block) { return doc < block.firstDoc; }) - 1;
+    uint32_t block = entry - _blockList;
+    const string *data = _getBlock(block);
+    if (!data) {
+        return "";
+    }
+    bool lastInBlock = (docIndex + 1 == header.docNum) || (block + 1 < _blockNum && docIndex + 1 == _blockList[block + 1].firstDoc);
+    uint32_t begin = _docOffsetList[docIndex];
+    uint32_t end = lastInBlock ? entry->rawSize : _docOffsetList[docIndex + 1];
+    return data->substr(begin, end - begin);
+}
@@ -0,0 +1,71 @@
+#ifndef SEARCHSYSTEM_DOCUMENTSTORE_H
+#define SEARCHSYSTEM_DOCUMENTSTORE_H
+
+#include "config.h"
+#include "IndexFormat.h"
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+
+// Compressed copy of the served text of every document, written while the collection is parsed,
+// so result content no longer needs the raw collection file.
+//
+// Documents are packed in page table order into blocks of about DOC_STORE_BLOCK_SIZE bytes, each compressed
+// with zlib. The block index gives each block's file offset and first document, and every document has its
+// 32-bit offset inside its block. Reading one document is one block read from the mapped file and one
+// decompression; the last DOC_STORE_CACHE_BLOCKS decompressed blocks are kept for the next hits.
+class DocumentStore {
+private:
+    struct BlockEntry {
+        uint64_t offset;  // absolute offset of the compressed block
+        uint32_t compressedSize;
+        uint32_t rawSize;
+        uint32_t firstDoc;  // index of the first document of the block
+        uint32_t reserved;
+    };
+
+    struct CachedBlock {
+        uint32_t block;
+        uint64_t lastUse;
+        string data;
+    };
+
+    // Writing
+    ofstream _outfile;
+    string _path;
+    string _block;  // raw text of the block being filled
+    vector<BlockEntry> _pendingBlocks;
+    vector<uint32_t> _pendingOffsets;
+    vector<uint8_t> _compressed;
+    void _flushBlock();
+
+    // Reading
+    const uint8_t *_mapped = nullptr;
+    size_t _mappedSize = 0;
+    const BlockEntry *_blockList = nullptr;
+    uint64_t _blockNum = 0;
+    const uint32_t *_docOffsetList = nullptr;
+    vector<CachedBlock> _cache;
+    uint64_t _useCount = 0;
+    const string *_getBlock(uint32_t block);
+    void _unmap();
+
+public:
+    FileHeader header;  // format header of the store file
+
+    DocumentStore();
+    ~DocumentStore();
+    DocumentStore(const DocumentStore &) = delete;  // owns the mapping of the store file
+    DocumentStore &operator=(const DocumentStore &) = delete;
+
+    bool create(const string &path);
+    void add(string_view content);  // next document, in page table order
+    void finish(const FileHeader &pageTableHeader);  // the page table the documents belong to
+    void load(const string &path, const FileHeader &pageTableHeader);
+    string get(uint32_t docIndex);
+};
+
+#endif //SEARCHSYSTEM_DOCUMENTSTORE_H
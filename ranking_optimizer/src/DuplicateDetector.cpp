@@ -0,0 +1,213 @@
+#include "DuplicateDetector.h"
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+
+DuplicateDetector::DuplicateDetector() {
+    clusterNum = 0;
+}
+
+
+DuplicateDetector::~DuplicateDetector() = default;
+
+
+// 64-bit FNV-1a with a final avalanche mix, stable across runs and platforms
+static uint64_t hashTerm(const string &term) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : term) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+
+// Computes the SimHash of a document: every term votes on each bit with weight 1 + log(freq).
+// The sublinear weight keeps frequent function words from deciding every bit on their own.
+uint64_t DuplicateDetector::simHash(const map<string, uint32_t> &termFreq) {
+    double votes[64] = {0};
+    for (const auto& [term, freq] : termFreq) {
+        uint64_t h = hashTerm(term);
+        double weight = 1.0 + log((double)freq);
+        for (int bit = 0; bit < 64; bit++) {
+            votes[bit] += ((h >> bit) & 1) ? weight : -weight;
+        }
+    }
+
+    uint64_t fingerprint = 0;
+    for (int bit = 0; bit < 64; bit++) {
+        if (votes[bit] > 0) {
+            fingerprint |= (1ULL << bit);
+        }
+    }
+    return fingerprint;
+}
+
+
+void DuplicateDetector::add(uint32_t docID, uint64_t fingerprint) {
+    _fingerprints.emplace_back(docID, fingerprint);
+}
+
+
+uint32_t DuplicateDetector::_find(uint32_t idx) {
+    while (_parent[idx] != idx) {
+        _parent[idx] = _parent[_parent[idx]];  // path halving
+        idx = _parent[idx];
+    }
+    return idx;
+}
+
+
+void DuplicateDetector::_union(uint32_t a, uint32_t b) {
+    uint32_t rootA = _find(a);
+    uint32_t rootB = _find(b);
+    if (rootA == rootB) {
+        return;
+    }
+    // Keep the root with the smaller docID so the root is always the canonical document
+    if (_fingerprints[rootA].first < _fingerprints[rootB].first) {
+        _parent[rootB] = rootA;
+    }
+    else {
+        _parent[rootA] = rootB;
+    }
+}
+
+
+// Buckets all fingerprints by one band and verifies the candidates inside each bucket.
+// Two fingerprints within SIMHASH_MAX_DISTANCE bits share at least one exact band as long as
+// SIMHASH_MAX_DISTANCE < SIMHASH_BANDS (pigeonhole), so scanning every band finds all pairs.
+void DuplicateDetector::_scanBand(int band, vector<pair<uint32_t, uint32_t>> &candidatePairs) {
+    const int bandBits = 64 / SIMHASH_BANDS;
+    const uint64_t bandMask = (bandBits == 64) ? ~0ULL : ((1ULL << bandBits) - 1);
+
+    // (band key, fingerprint index), sorted so that equal keys form contiguous buckets
+    vector<pair<uint64_t, uint32_t>> keys;
+    keys.reserve(_fingerprints.size());
+    for (uint32_t i = 0; i < _fingerprints.size(); i++) {
+        keys.emplace_back((_fingerprints[i].second >> (band * bandBits)) & bandMask, i);
+    }
+    sort(keys.begin(), keys.end(), [this](const pair<uint64_t, uint32_t> &a, const pair<uint64_t, uint32_t> &b) {
+        if (a.first != b.first) {
+            return a.first < b.first;
+        }
+        return _fingerprints[a.second].second < _fingerprints[b.second].second;
+    });
+
+    size_t bucketBegin = 0;
+    while (bucketBegin < keys.size()) {
+        size_t bucketEnd = bucketBegin + 1;
+        while (bucketEnd < keys.size() && keys[bucketEnd].first == keys[bucketBegin].first) {
+            bucketEnd++;
+        }
+        // Compare within the bucket; huge buckets only compare against nearby fingerprints
+        for (size_t i = bucketBegin; i < bucketEnd; i++) {
+            for (size_t j = i + 1; j < bucketEnd && j <= i + SIMHASH_MAX_BUCKET; j++) {
+                uint64_t diff = _fingerprints[keys[i].second].second ^ _fingerprints[keys[j].second].second;
+                if (__builtin_popcountll(diff) <= SIMHASH_MAX_DISTANCE) {
+                    candidatePairs.emplace_back(keys[i].second, keys[j].second);
+                }
+            }
+        }
+        bucketBegin = bucketEnd;
+    }
+}
+
+
+// Clusters near-duplicate documents and fills canonicalMap
+void DuplicateDetector::detect() {
+    _parent.resize(_fingerprints.size());
+    for (uint32_t i = 0; i < _parent.size(); i++) {
+        _parent[i] = i;
+    }
+
+    // Scan every LSH band in its own thread
+    vector<vector<pair<uint32_t, uint32_t>>> bandPairs(SIMHASH_BANDS);
+    vector<thread> workers;
+    for (int band = 0; band < SIMHASH_BANDS; band++) {
+        workers.emplace_back(&DuplicateDetector::_scanBand, this, band, ref(bandPairs[band]));
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // Merge the verified pairs into clusters
+    for (const auto &pairs : bandPairs) {
+        for (const auto& [a, b] : pairs) {
+            _union(a, b);
+        }
+    }
+
+    canonicalMap.clear();
+    for (uint32_t i = 0; i < _fingerprints.size(); i++) {
+        uint32_t root = _find(i);
+        if (root != i) {
+            canonicalMap[_fingerprints[i].first] = _fingerprints[root].first;
+        }
+    }
+
+    // Count clusters by their canonical documents
+    map<uint32_t, bool> canonicalDocs;
+    for (const auto& [docID, canonicalID] : canonicalMap) {
+        canonicalDocs[canonicalID] = true;
+    }
+    clusterNum = canonicalDocs.size();
+
+    _fingerprints.clear();
+    _fingerprints.shrink_to_fit();
+    _parent.clear();
+    _parent.shrink_to_fit();
+}
+
+
+// Writes the duplicate -> canonical mapping, one "docID canonicalID" pair per line
+void DuplicateDetector::write() {
+    ofstream outfile(DUPLICATE_PATH);
+    if (!outfile.is_open()) {
+        cerr << "Error opening output file: " << DUPLICATE_PATH << endl;
+        return;
+    }
+    for (const auto& [docID, canonicalID] : canonicalMap) {
+        outfile << docID << " " << canonicalID << endl;
+    }
+    outfile.close();
+}
+
+
+void DuplicateDetector::load() {
+    ifstream infile(DUPLICATE_PATH);
+    if (!infile) {
+        cout << "can not read " << DUPLICATE_PATH << endl;
+        exit(0);
+    }
+    canonicalMap.clear();
+
+    uint32_t docID, canonicalID;
+    map<uint32_t, bool> canonicalDocs;
+    while (infile >> docID >> canonicalID) {
+        canonicalMap[docID] = canonicalID;
+        canonicalDocs[canonicalID] = true;
+    }
+    clusterNum = canonicalDocs.size();
+    cout << "There are " << canonicalMap.size() << " near-duplicate documents in "
+         << clusterNum << " clusters" << endl;
+}
+
+
+bool DuplicateDetector::isDuplicate(uint32_t docID) const {
+    return canonicalMap.find(docID) != canonicalMap.end();
+}
+
+
+// Returns the canonical docID of the cluster, or docID itself when it has no duplicate
+uint32_t DuplicateDetector::getCanonical(uint32_t docID) const {
+    auto it = canonicalMap.find(docID);
+    if (it == canonicalMap.end()) {
+        return docID;
+    }
+    return it->second;
+}
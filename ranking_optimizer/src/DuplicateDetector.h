@@ -0,0 +1,40 @@
+#ifndef SEARCHSYSTEM_DUPLICATEDETECTOR_H
+#define SEARCHSYSTEM_DUPLICATEDETECTOR_H
+
+#include "config.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+using namespace std;
+
+
+// Near-duplicate detection with 64-bit SimHash fingerprints and banded LSH.
+// Documents whose fingerprints differ in at most SIMHASH_MAX_DISTANCE bits are clustered,
+// and every cluster is represented by its smallest docID (the canonical document).
+class DuplicateDetector {
+private:
+    vector<pair<uint32_t, uint64_t>> _fingerprints;  // (docID, fingerprint) in insertion order
+    vector<uint32_t> _parent;  // union-find forest over fingerprint indices
+
+    uint32_t _find(uint32_t idx);
+    void _union(uint32_t a, uint32_t b);
+    void _scanBand(int band, vector<pair<uint32_t, uint32_t>> &candidatePairs);  // collect near-duplicate pairs of one band
+
+public:
+    map<uint32_t, uint32_t> canonicalMap;  // duplicate docID -> canonical docID (canonical docs are not stored)
+    uint32_t clusterNum;  // number of clusters with at least one duplicate
+
+    DuplicateDetector();
+    ~DuplicateDetector();
+
+    static uint64_t simHash(const map<string, uint32_t> &termFreq);  // fingerprint from the (term, freq) counts
+    void add(uint32_t docID, uint64_t fingerprint);
+    void detect();  // cluster near-duplicates, bands are scanned in parallel
+    void write();
+    void load();
+    bool isDuplicate(uint32_t docID) const;
+    uint32_t getCanonical(uint32_t docID) const;
+};
+
+#endif //SEARCHSYSTEM_DUPLICATEDETECTOR_H
@@ -0,0 +1,197 @@
+#include "EliasFano.h"
+#include "PostingCodec.h"
+#include <cstring>
+#include <algorithm>
+using namespace std;
+
+
+static inline uint32_t selectInWord(uint64_t word, uint32_t k) {
+    for (uint32_t i = 0; i < k; i++) {
+        word &= word - 1;  // clear the lowest set bit
+    }
+    return __builtin_ctzll(word);
+}
+
+
+// Low bit width minimizing the chunk: floor(log2(universe / n))
+static inline uint32_t lowBitWidth(uint32_t universe, size_t n) {
+    uint32_t ratio = universe / n;
+    return ratio ? 31 - __builtin_clz(ratio) : 0;
+}
+
+
+size_t efEncode(const uint32_t *gaps, size_t n, vector<uint8_t> &out) {
+    size_t begin = out.size();
+    uint32_t docIds[POSTINGS_PER_CHUNK];
+    uint32_t docId = 0;
+    for (size_t i = 0; i < n; i++) {
+        docId += gaps[i];
+        docIds[i] = docId;
+    }
+    uint32_t base = docIds[0];
+    uint32_t l = lowBitWidth(docIds[n - 1] - base, n);
+
+    out.push_back(n);
+    out.push_back(l);
+    uint32_t value = base;
+    while (value > 0x7F) {
+        out.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(value);
+
+    size_t lowerBytes = (n * l + 7) / 8;
+    size_t upperBits = n + ((docIds[n - 1] - base) >> l) + 1;
+    size_t lowerBegin = out.size();
+    out.resize(lowerBegin + lowerBytes + (upperBits + 7) / 8, 0);
+    uint8_t *lower = &out[lowerBegin];
+    uint8_t *upper = lower + lowerBytes;
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t v = docIds[i] - base;
+        // Low bits, little-endian bit stream
+        for (uint32_t bit = 0; bit < l; bit++) {
+            if ((v >> bit) & 1) {
+                size_t pos = i * l + bit;
+                lower[pos / 8] |= 1 << (pos % 8);
+            }
+        }
+        size_t pos = (v >> l) + i;
+        upper[pos / 8] |= 1 << (pos % 8);
+    }
+    return out.size() - begin;
+}
+
+
+size_t efDecode(const uint8_t *in, size_t length, uint32_t *out) {
+    EliasFanoChunk chunk;
+    if (!chunk.open(in, length)) {
+        return 0;
+    }
+    return chunk.decode(out);
+}
+
+
+// Sequential decode: walks the set upper bits once instead of a select per value
+size_t EliasFanoChunk::decode(uint32_t *out) const {
+    uint32_t prev = 0;
+    uint32_t i = 0;
+    for (uint32_t word = 0; word < UPPER_WORDS && i < _n; word++) {
+        uint64_t bits = _upper[word];
+        while (bits && i < _n) {
+            uint32_t high = word * 64 + __builtin_ctzll(bits) - i;
+            uint32_t docId = _base + ((high << _l) | _lowBits(i));
+            out[i++] = docId - prev;
+            prev = docId;
+            bits &= bits - 1;
+        }
+    }
+    return _n;
+}
+
+
+bool EliasFanoChunk::open(const uint8_t *in, size_t length) {
+    if (length < 3) {
+        return false;
+    }
+    _n = in[0];
+    _l = in[1];
+    size_t pos = 2;
+    _base = 0;
+    for (int shift = 0; pos < length; shift += 7) {
+        uint8_t byte = in[pos++];
+        _base |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+
+    size_t lowerBytes = (_n * _l + 7) / 8;
+    size_t upperBytes = length - pos - lowerBytes;
+    if (pos + lowerBytes > length || lowerBytes > sizeof(_lower) || upperBytes > sizeof(_upper)) {
+        return false;
+    }
+    memset(_lower, 0, sizeof(_lower));
+    memset(_upper, 0, sizeof(_upper));
+    memcpy(_lower, in + pos, lowerBytes);
+    memcpy(_upper, in + pos + lowerBytes, upperBytes);
+    _last = _n ? access(_n - 1) : 0;
+    return true;
+}
+
+
+uint32_t EliasFanoChunk::_lowBits(uint32_t i) const {
+    if (_l == 0) {
+        return 0;
+    }
+    uint32_t pos = i * _l;
+    uint32_t word = pos / 64, shift = pos % 64;
+    uint64_t bits = _lower[word] >> shift;
+    if (shift + _l > 64) {
+        bits |= _lower[word + 1] << (64 - shift);
+    }
+    return (uint32_t)(bits & ((1ULL << _l) - 1));
+}
+
+
+uint32_t EliasFanoChunk::_select1(uint32_t k) const {
+    for (uint32_t word = 0; word < UPPER_WORDS; word++) {
+        uint32_t ones = __builtin_popcountll(_upper[word]);
+        if (k < ones) {
+            return word * 64 + selectInWord(_upper[word], k);
+        }
+        k -= ones;
+    }
+    return UPPER_WORDS * 64;
+}
+
+
+uint32_t EliasFanoChunk::_select0(uint32_t k) const {
+    for (uint32_t word = 0; word < UPPER_WORDS; word++) {
+        uint32_t zeros = 64 - __builtin_popcountll(_upper[word]);
+        if (k < zeros) {
+            return word * 64 + selectInWord(~_upper[word], k);
+        }
+        k -= zeros;
+    }
+    return UPPER_WORDS * 64;
+}
+
+
+uint32_t EliasFanoChunk::access(uint32_t i) const {
+    uint32_t high = _select1(i) - i;
+    return _base + ((high << _l) | _lowBits(i));
+}
+
+
+uint32_t EliasFanoChunk::nextGEQ(uint32_t target) const {
+    if (_n == 0 || target <= _base) {
+        return 0;
+    }
+    if (target > _last) {
+        return _n;  // the upper bits hold fewer than `high` zeros, the search below would run past them
+    }
+    uint32_t v = target - _base;
+    uint32_t high = v >> _l;
+
+    // Values with upper part `high` start right after the high-th zero of the upper bits
+    uint32_t pos = high ? _select0(high - 1) + 1 : 0;
+    uint32_t i = pos - high;  // ones before pos
+
+    // Scan the ones from pos: each one is the next value, each zero raises the upper part by one
+    while (i < _n) {
+        uint64_t bit = (_upper[pos / 64] >> (pos % 64)) & 1;
+        if (bit) {
+            uint32_t current = ((pos - i) << _l) | _lowBits(i);
+            if (current >= v) {
+                return i;
+            }
+            i++;
+        }
+        else {
+            return i;  // passed into a larger upper part: the next value is already >= target
+        }
+        pos++;
+    }
+    return _n;
+}
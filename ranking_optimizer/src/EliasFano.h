@@ -0,0 +1,48 @@
+#ifndef SEARCHSYSTEM_ELIASFANO_H
+#define SEARCHSYSTEM_ELIASFANO_H
+
+#include "config.h"
+#include "Varbyte.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+using namespace std;
+
+
+// Elias-Fano codec for docID chunks (partitioned Elias-Fano: every chunk of at most POSTINGS_PER_CHUNK
+// docIDs is one partition, and the lastDocId block metadata already holds the partition upper bounds).
+//
+// Chunk layout: [value count n][low bit width l][first docID, varbyte][n * l low bits][upper bits]
+// Value i is stored as v = docID_i - first docID: its low l bits go to the lower array, and bit
+// (v >> l) + i is set in the upper bit array, so v >> l is the number of zeros before the i-th one.
+
+size_t efEncode(const uint32_t *gaps, size_t n, vector<uint8_t> &out);  // gaps as written by _writeBlocks
+size_t efDecode(const uint8_t *in, size_t length, uint32_t *out);  // back to gaps, out holds 64
+
+
+// Read-only view of one encoded chunk; random access and nextGEQ work without decoding the chunk
+class EliasFanoChunk {
+private:
+    static const uint32_t UPPER_WORDS = 4;  // upper bits never exceed 3 * POSTINGS_PER_CHUNK + 1
+    static const uint32_t LOWER_WORDS = POSTINGS_PER_CHUNK / 2 + 1;  // 64 values of up to 32 bits
+
+    uint32_t _n = 0;
+    uint32_t _l = 0;
+    uint32_t _base = 0;
+    uint32_t _last = 0;  // largest value, set by open()
+    uint64_t _upper[UPPER_WORDS]{};
+    uint64_t _lower[LOWER_WORDS]{};
+
+    uint32_t _lowBits(uint32_t i) const;
+    uint32_t _select1(uint32_t k) const;  // position of the k-th set upper bit
+    uint32_t _select0(uint32_t k) const;  // position of the k-th zero upper bit
+
+public:
+    bool open(const uint8_t *in, size_t length);
+    uint32_t size() const { return _n; }
+    uint32_t access(uint32_t i) const;  // i-th docID of the chunk
+    uint32_t nextGEQ(uint32_t target) const;  // index of the first docID >= target, size() if none
+    size_t decode(uint32_t *out) const;  // all values as gaps, the first one absolute
+};
+
+#endif //SEARCHSYSTEM_ELIASFANO_H
@@ -7,6 +7,8 @@
 #include <vector>
 #include <tuple>
 #include <sstream>
+#include <iomanip>
+#include <chrono>
 
 
 // Struct for comparing entries in the priority queue (min-heap)
@@ -101,6 +103,11 @@ uint32_t IndexBuilder::_calcWordFreq(string text, uint32_t docID) {
         sortedPosting.print();
     }
 
+    // Fingerprint the document for near-duplicate detection
+    if (DEDUP_MODE) {
+        duplicateDetector.add(docID, DuplicateDetector::simHash(sortedPosting.sortedList));
+    }
+
     // Insert the word frequencies into the inverted list
     for (const auto& [word, count] : sortedPosting.sortedList) {
         invertedList.insertWord(word, docID, count);
@@ -116,6 +123,7 @@ void IndexBuilder::readData(const char *filepath) {
         cerr << "Error opening file: " << filepath << endl;
         return;
     }
+    _startReading();
 
     const size_t BUFFER_SIZE = INDEX_BUFFER_SIZE;  // Define buffer size
     cout << "Index Buffer Size: " << BUFFER_SIZE / 1024 << " KB" << endl;
@@ -184,6 +192,7 @@ void IndexBuilder::readData(const char *filepath) {
                         doc.wordCount = _calcWordFreq(fullText, doc.docId);  // Calculate word frequency
                         doc.docPos = currentPos;
                         pageTable.add(doc);  // Add the document to the page table
+                        documentStore.add(fullText);  // Keep its text for result content
                         // Manually update the position based on the content length
                         currentPos += docContent.size() + 1; // +1 for the newline character
 
@@ -204,12 +213,83 @@ void IndexBuilder::readData(const char *filepath) {
         }
     }
 
+    _finishReading();
+
+    // Clean up
+    delete[] buffer;
+    infile.close();  // Close the file stream
+}
+
+
+// Reads a BEIR corpus.jsonl. String "_id"s are mapped to dense internal docIDs in file order,
+// and the document position points at the JSON line so the content can be served from the corpus.
+void IndexBuilder::readBeirCorpus(const char *filepath) {
+    ifstream infile(filepath);
+    if (!infile.is_open()) {
+        cerr << "Error opening file: " << filepath << endl;
+        return;
+    }
+    _startReading();
+
+    const size_t BUFFER_SIZE = INDEX_BUFFER_SIZE;
+    char *buffer = new char[BUFFER_SIZE];
+    infile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);  // Set custom buffer for efficient I/O
+
+    string line;
+    map<string, string> fields;
+    streamoff currentPos = 0;
+
+    while (getline(infile, line)) {
+        streamoff linePos = currentPos;
+        currentPos += line.size() + 1;  // +1 for the newline character
+
+        if (!BeirReader::parseLine(line, fields) || !fields.count("_id")) {
+            cerr << "Invalid BEIR document line: " << line.substr(0, 100) << endl;
+            continue;
+        }
+
+        Document doc;
+        doc.docId = pageTable.totalDoc;  // internal docIDs are assigned densely from 0
+        doc.dataLength = line.size();
+        string text = BeirReader::getDocumentText(fields);
+        doc.wordCount = _calcWordFreq(text, doc.docId);
+        doc.docPos = linePos;
+        pageTable.add(doc);
+        documentStore.add(text);
+        pageTable.externalIdList.push_back(fields["_id"]);
+
+        if (DEBUG_MODE && doc.docId % 10000 == 0) {
+            cout << "Processing DocID: " << doc.docId << " (" << fields["_id"] << ")" << endl;
+        }
+    }
+
+    _finishReading();
+
+    delete[] buffer;
+    infile.close();
+}
+
+
+// The document store is written along with the page table it is indexed by
+void IndexBuilder::_startReading() {
+    if (DOC_STORE_MODE && (PAGE_TABLE_FLAG & PARSE_INDEX_FLAG)) {
+        documentStore.create(DOC_STORE_PATH);
+    }
+}
+
+
+void IndexBuilder::_finishReading() {
     // Write the inverted list to disk if it contains any entries
     if (!invertedList.hashWord.empty()) {
         invertedList.writeToFile();
         invertedList.clear();
     }
 
+    // Cluster near-duplicates now that every document has a fingerprint
+    if (DEDUP_MODE) {
+        _detectDuplicates();
+    }
+
     // Optionally print the page table if debugging
     if (DEBUG_MODE & 0) {
         pageTable.print();  // Print the page table
@@ -223,12 +303,40 @@ void IndexBuilder::readData(const char *filepath) {
         clock_t write_page_time = write_page_end - write_page_begin;
         cout << "Writing Page Table Takes " << double(write_page_time) / 1000000 << " Seconds" << endl;
     }
+}
 
-    // Clean up
-    delete[] buffer;
-    infile.close();  // Close the file stream
+// Runs near-duplicate detection over all parsed documents and reports how much of the index they take
+void IndexBuilder::_detectDuplicates() {
+    auto detect_begin = chrono::steady_clock::now();  // wall time: detect() runs on several threads
+    duplicateDetector.detect();
+    duplicateDetector.write();
+    double detect_time = chrono::duration<double>(chrono::steady_clock::now() - detect_begin).count();
+
+    // Every unique word of a duplicate document is one posting that can be dropped
+    uint64_t allPostings = 0, duplicatePostings = 0, duplicateBytes = 0;
+    for (uint32_t i = 0; i < pageTable.totalDoc; i++) {
+        allPostings += pageTable.wordCountList[i];
+        if (duplicateDetector.isDuplicate(pageTable.docIdList[i])) {
+            duplicatePostings += pageTable.wordCountList[i];
+            duplicateBytes += pageTable.dataLengthList[i];
+        }
+    }
+    double postingRatio = allPostings ? 100.0 * duplicatePostings / allPostings : 0;
+
+    ios::fmtflags flags = cout.flags();
+    streamsize precision = cout.precision();
+    cout << "Near-duplicate detection takes " << detect_time << " Seconds" << endl;
+    cout << "Found " << duplicateDetector.canonicalMap.size() << " near-duplicates of "
+         << duplicateDetector.clusterNum << " canonical documents (" << pageTable.totalDoc << " documents in total)" << endl;
+    cout << "Duplicates hold " << duplicatePostings << " of " << allPostings << " postings ("
+         << fixed << setprecision(2) << postingRatio << "%) and " << duplicateBytes / 1024 << " KB of text" << endl;
+    cout << "Dropping them (DEDUP_MODE 2) removes about " << postingRatio << "% of the postings; the final index size "
+         << "is printed by the lexicon build" << endl;
+    cout.flags(flags);
+    cout.precision(precision);
 }
 
+
 // N-way merge logic with support for binary and ASCII modes
 // Helper function to parse postings from a string
 vector<pair<uint32_t, uint32_t>> IndexBuilder::_parsePostings(const string& postingsStr) {
@@ -245,13 +353,27 @@ vector<pair<uint32_t, uint32_t>> IndexBuilder::_parsePostings(const string& post
 
 // Helper function to write merged postings to output, ensuring correct handling for single postings
 void IndexBuilder::_writeMergedPostings(ofstream& outfile, const string& word, const vector<pair<uint32_t, uint32_t>>& postings) {
-    if (!postings.empty()) {  // Ensure that we only write non-empty posting lists
+    // Drop postings of near-duplicate documents, only their canonical document stays searchable
+    vector<pair<uint32_t, uint32_t>> keptPostings;
+    if (DEDUP_MODE == 2) {
+        for (const auto& posting : postings) {
+            if (duplicateDetector.isDuplicate(posting.first)) {
+                _droppedPostings += 1;
+            }
+            else {
+                keptPostings.push_back(posting);
+            }
+        }
+    }
+    const vector<pair<uint32_t, uint32_t>>& written = (DEDUP_MODE == 2) ? keptPostings : postings;
+
+    if (!written.empty()) {  // Ensure that we only write non-empty posting lists
         outfile << word << ":";
-        for (size_t i = 0; i < postings.size(); ++i) {
+        for (size_t i = 0; i < written.size(); ++i) {
             if (i > 0) {
                 outfile << ",";
             }
-            outfile << postings[i].first << " " << postings[i].second;
+            outfile << written[i].first << " " << written[i].second;
         }
         outfile << endl;  // Write the newline to properly terminate the entry
     }
@@ -308,6 +430,12 @@ void IndexBuilder::mergeIndex() {
 
     vector<ifstream> inputStreams(leftIndexNum);
 
+    // Load the duplicate mapping when the collection was parsed in an earlier run
+    if (DEDUP_MODE == 2 && !PARSE_INDEX_FLAG) {
+        duplicateDetector.load();
+    }
+    _droppedPostings = 0;
+
     // Open all intermediate files and add the first word from each file into the priority queue
     for (uint32_t i = 0; i < leftIndexNum; ++i) {
         string path = invertedList.getIndexFilePath(i);
@@ -381,16 +509,16 @@ void IndexBuilder::mergeIndex() {
     }
 
     outfile.close();  // Close the output file
-}
 
-void IndexBuilder::buildLexicon(){
-    string path = invertedList.getIndexFilePath(invertedList.indexFileCount - 1);
-    lexicon.build(path);
+    if (DEDUP_MODE == 2) {
+        cout << "Dropped " << _droppedPostings << " postings of near-duplicate documents" << endl;
+    }
 }
 
 // Writes the page table to disk
 void IndexBuilder::writePageTable() {
     pageTable.write();
+    documentStore.finish(pageTable.header);
 }
 
 // Writes the lexicon to disk
@@ -10,6 +10,9 @@
 #include "PageTable.h"
 #include "InvertedList.h"
 #include "Lexicon.h"
+#include "DuplicateDetector.h"
+#include "BeirReader.h"
+#include "DocumentStore.h"
 #include <string>
 #include <vector>
 #include <utility>
@@ -38,19 +41,26 @@ private:
     vector<pair<uint32_t, uint32_t>> _parsePostings(const string& postingsStr);  // Parse postings from a string
     void _mergePostingLists(vector<pair<uint32_t, uint32_t>>& base, const vector<pair<uint32_t, uint32_t>>& newPostings, bool ordered);  // Merge posting lists for a given word
     void _writeMergedPostings(ofstream& outfile, const string& word, const vector<pair<uint32_t, uint32_t>>& postings);  // Write merged postings to file
+    void _detectDuplicates();  // Cluster near-duplicate documents and report the savings
+    void _startReading();  // Open the document store before a collection is parsed
+    void _finishReading();  // Flush postings and write the page table after a collection is parsed
+
+    uint64_t _droppedPostings = 0;  // postings of near-duplicates dropped while merging
 
 public:
     PageTable pageTable;
     InvertedList invertedList;
     Lexicon lexicon;
+    DuplicateDetector duplicateDetector;
+    DocumentStore documentStore;  // text of every document, for result content
 
     IndexBuilder();
     ~IndexBuilder();
 
     /* Public functions */
     void readData(const char *filepath);  // Read data from the file
+    void readBeirCorpus(const char *filepath);  // Read a BEIR corpus.jsonl, assigning internal docIDs
     void mergeIndex();  // Perform multi-way merge of index files into one
-    void buildLexicon();
     void writePageTable();  // Write page table to disk
     void writeLexicon();  // Write lexicon to disk
 };
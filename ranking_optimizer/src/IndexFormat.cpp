@@ -0,0 +1,238 @@
+#include "IndexFormat.h"
+#include "zlib.h"
+#include <cstddef>
+#include <cstring>
+#include <sys/mman.h>  // For mmap, munmap and madvise
+#include <fcntl.h>     // For open
+#include <unistd.h>    // For close and sysconf
+#include <sys/stat.h>  // For fstat
+#include <vector>
+using namespace std;
+
+
+static_assert(sizeof(FileHeader) == 288, "FileHeader layout is part of the file format");
+
+static const size_t CRC_BUFFER_SIZE = 1 << 20;  // 1 MB reads while checksumming a section
+
+
+static const char *magicName(uint32_t magic) {
+    switch (magic) {
+        case FORMAT_MAGIC_INDEX: return "index";
+        case FORMAT_MAGIC_LEXICON: return "lexicon";
+        case FORMAT_MAGIC_PAGE_TABLE: return "page table";
+        case FORMAT_MAGIC_DOC_STORE: return "document store";
+        default: return "unknown";
+    }
+}
+
+
+FileHeader newFileHeader(uint32_t magic) {
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = magic;
+    header.version = INDEX_FORMAT_VERSION;
+    header.headerSize = sizeof(FileHeader);
+    return header;
+}
+
+
+// zlib's CRC-32 takes 32-bit lengths, larger buffers go in pieces
+uint32_t crc32Of(const void *data, size_t length, uint32_t crc) {
+    const auto *bytes = static_cast<const Bytef *>(data);
+    while (length > 0) {
+        uInt piece = (uInt)min<size_t>(length, 1u << 30);
+        crc = crc32(crc, bytes, piece);
+        bytes += piece;
+        length -= piece;
+    }
+    return crc;
+}
+
+
+static uint32_t headerCrcOf(const FileHeader &header) {
+    return crc32Of(&header, offsetof(FileHeader, headerCrc));
+}
+
+
+// Streams one section of an open file through the CRC
+static bool sectionCrcOf(istream &file, const FileSection &section, uint32_t &crc) {
+    vector<char> buffer(CRC_BUFFER_SIZE);
+    file.clear();
+    file.seekg(section.offset);
+    crc = 0;
+    uint64_t remaining = section.size;
+    while (remaining > 0) {
+        size_t piece = min<uint64_t>(remaining, buffer.size());
+        if (!file.read(buffer.data(), piece)) {
+            return false;
+        }
+        crc = crc32Of(buffer.data(), piece, crc);
+        remaining -= piece;
+    }
+    return true;
+}
+
+
+void writeHeaderPlaceholder(ofstream &outfile) {
+    FileHeader empty;
+    memset(&empty, 0, sizeof(empty));
+    outfile.write(reinterpret_cast<const char *>(&empty), sizeof(empty));
+}
+
+
+void alignSection(ofstream &outfile) {
+    static const char padding[8] = {0};
+    uint64_t offset = outfile.tellp();
+    outfile.write(padding, (8 - offset % 8) % 8);
+}
+
+
+void beginSection(FileHeader &header, uint32_t id, uint64_t offset) {
+    if (header.sectionNum >= FORMAT_MAX_SECTIONS) {
+        cerr << "Too many sections in one " << magicName(header.magic) << " file" << endl;
+        return;
+    }
+    FileSection &section = header.sectionList[header.sectionNum++];
+    section.id = id;
+    section.offset = offset;
+    section.size = 0;
+}
+
+
+void endSection(FileHeader &header, uint64_t offset) {
+    FileSection &section = header.sectionList[header.sectionNum - 1];
+    section.size = offset - section.offset;
+}
+
+
+bool finalizeFile(const string &path, FileHeader &header) {
+    fstream file(path, fstream::in | fstream::out | fstream::binary);
+    if (!file.is_open()) {
+        cerr << "Error opening file to finalize: " << path << endl;
+        return false;
+    }
+    for (uint32_t i = 0; i < header.sectionNum; i++) {
+        if (!sectionCrcOf(file, header.sectionList[i], header.sectionList[i].crc)) {
+            cerr << "Error reading section " << header.sectionList[i].id << " of " << path << endl;
+            return false;
+        }
+    }
+    header.headerCrc = headerCrcOf(header);
+    file.clear();
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    return file.good();
+}
+
+
+bool readHeader(const string &path, uint32_t magic, FileHeader &header) {
+    ifstream infile(path, ifstream::binary | ifstream::ate);
+    if (!infile.is_open()) {
+        cerr << "can not read " << path << endl;
+        return false;
+    }
+    uint64_t fileSize = infile.tellg();
+    if (fileSize < sizeof(FileHeader)) {
+        cerr << path << ": truncated, " << fileSize << " bytes is shorter than the file header" << endl;
+        return false;
+    }
+    infile.seekg(0);
+    infile.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+    if (header.magic != magic) {
+        cerr << path << ": not a " << magicName(magic) << " file (found " << magicName(header.magic)
+             << "), rebuild it with the current version" << endl;
+        return false;
+    }
+    if (header.version != INDEX_FORMAT_VERSION || header.headerSize != sizeof(FileHeader)) {
+        cerr << path << ": format version " << header.version << ", expected " << INDEX_FORMAT_VERSION << endl;
+        return false;
+    }
+    if (header.headerCrc != headerCrcOf(header) || header.sectionNum > FORMAT_MAX_SECTIONS) {
+        cerr << path << ": corrupted file header" << endl;
+        return false;
+    }
+    for (uint32_t i = 0; i < header.sectionNum; i++) {
+        const FileSection &section = header.sectionList[i];
+        if (section.offset < sizeof(FileHeader) || section.offset > fileSize || section.size > fileSize - section.offset) {
+            cerr << path << ": truncated, section " << section.id << " ends at " << section.offset + section.size
+                 << " but the file has " << fileSize << " bytes" << endl;
+            return false;
+        }
+        if (FORMAT_VERIFY_CHECKSUM) {
+            uint32_t crc;
+            if (!sectionCrcOf(infile, section, crc) || crc != section.crc) {
+                cerr << path << ": checksum mismatch in section " << section.id << endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+const FileSection *findSection(const FileHeader &header, uint32_t id) {
+    for (uint32_t i = 0; i < header.sectionNum; i++) {
+        if (header.sectionList[i].id == id) {
+            return &header.sectionList[i];
+        }
+    }
+    return nullptr;
+}
+
+
+uint32_t sourceCrcOf(const FileHeader &source) {
+    uint32_t crc = 0;
+    for (uint32_t i = 0; i < source.sectionNum; i++) {
+        crc = crc32Of(&source.sectionList[i].crc, sizeof(uint32_t), crc);
+    }
+    return crc;
+}
+
+
+// A file must have been built from exactly the source file that is loaded next to it
+bool checkSource(const FileHeader &header, const FileHeader &source, const string &path, const string &sourcePath) {
+    if (source.sectionNum == 0 || header.sourceCrc != sourceCrcOf(source)) {
+        cerr << path << " was not built from " << sourcePath << ", rebuild the index" << endl;
+        return false;
+    }
+    return true;
+}
+
+
+const uint8_t *mapFile(const string &path, size_t &size) {
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat fileStats;
+    if (fd == -1 || fstat(fd, &fileStats) == -1) {
+        cerr << "can not read " << path << endl;
+        if (fd != -1) {
+            close(fd);
+        }
+        return nullptr;
+    }
+    size = fileStats.st_size;
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        perror("mmap failed");
+        return nullptr;
+    }
+    return static_cast<const uint8_t *>(mapped);
+}
+
+
+void unmapFile(const uint8_t *data, size_t size) {
+    if (data) {
+        munmap(const_cast<uint8_t *>(data), size);
+    }
+}
+
+
+void adviseFile(const uint8_t *data, uint64_t offset, uint64_t length, int advice) {
+    if (!data || length == 0) {
+        return;
+    }
+    uint64_t pageSize = sysconf(_SC_PAGE_SIZE);
+    uint64_t begin = offset & ~(pageSize - 1);
+    madvise(const_cast<uint8_t *>(data) + begin, offset + length - begin, advice);
+}
@@ -0,0 +1,96 @@
+#ifndef SEARCHSYSTEM_INDEXFORMAT_H
+#define SEARCHSYSTEM_INDEXFORMAT_H
+
+#include "config.h"
+#include <cstdint>
+#include <string>
+using namespace std;
+
+
+// Container format shared by the final index, the lexicon and the page table.
+//
+// File layout: [FileHeader][section 0][section 1]...
+// The header is fixed-size and little-endian. Every section is a byte range of the file with its own
+// CRC-32, and all offsets are 64-bit and absolute, so a lexicon offset can be used directly as a file position.
+// Files link to the file they were built from: the index records the CRC of the page table's section CRCs and
+// the lexicon records the index's, so files from different builds are detected at load time.
+// Sections start 8-byte aligned, so a mapped file can be read in place as arrays.
+
+#define FORMAT_MAGIC_INDEX 0x58494F52  // "ROIX"
+#define FORMAT_MAGIC_LEXICON 0x584C4F52  // "ROLX"
+#define FORMAT_MAGIC_PAGE_TABLE 0x54504F52  // "ROPT"
+#define FORMAT_MAGIC_DOC_STORE 0x53444F52  // "RODS"
+
+#define FORMAT_MAX_SECTIONS 8
+
+#define SECTION_POSTINGS 1  // index: blocks of every list, in lexicon order
+#define SECTION_TERMS 2  // lexicon: the term dictionary image, see TermDictionary.h
+#define SECTION_DOCUMENTS 3  // page table: internal docID of every document, uint32
+#define SECTION_SKIP_BLOCKS 4  // index: SkipEntry of every block, in lexicon order
+#define SECTION_SKIP_CHUNKS 5  // index: last docID of every chunk, in lexicon order
+#define SECTION_SKIP_CHUNK_MAX 6  // index: score upper bound of every chunk in impact levels, one byte each
+#define SECTION_TERM_HASH 7  // lexicon: minimal perfect hash from term to dictionary index, see TermHash.h
+#define SECTION_DOC_LENGTHS 8  // page table: words of every document, uint32
+#define SECTION_DOC_DATA_LENGTHS 9  // page table: bytes of every document in the collection file, uint32
+#define SECTION_DOC_POSITIONS 10  // page table: offset of every document in the collection file, uint64
+#define SECTION_EXTERNAL_IDS 11  // page table: docNum + 1 uint64 offsets into the external ID bytes that follow
+#define SECTION_DOC_STORE_BLOCKS 12  // document store: zlib-compressed blocks of document text
+#define SECTION_DOC_STORE_BLOCK_INDEX 13  // document store: offset, sizes and first document of every block
+#define SECTION_DOC_STORE_OFFSETS 14  // document store: offset of every document inside its block, uint32
+#define SECTION_DENSE_LISTS 15  // index: DenseListEntry of every list with Roaring containers, see RoaringList.h
+
+#define FORMAT_FLAG_IMPACT 1  // postings store quantized BM25 impacts instead of frequencies
+#define FORMAT_FLAG_NORM_BYTES 2  // scores were computed with one-byte document lengths, see BM25_NORM_BYTES
+
+
+struct FileSection {
+    uint32_t id;  // SECTION_*, 0 for an unused slot
+    uint32_t crc;  // CRC-32 of the section bytes
+    uint64_t offset;  // absolute file offset
+    uint64_t size;  // bytes
+};
+
+
+struct FileHeader {
+    uint32_t magic;  // FORMAT_MAGIC_*
+    uint32_t version;  // INDEX_FORMAT_VERSION of the writer
+    uint32_t headerSize;  // sizeof(FileHeader)
+    uint32_t flags;  // FORMAT_FLAG_*
+    uint32_t codec;  // POSTING_CODEC of the build (CODEC_AUTO: the lexicon records a codec per list)
+    uint32_t impactLevels;  // IMPACT_LEVELS, when FORMAT_FLAG_IMPACT is set
+    uint64_t docNum;  // documents in the collection
+    uint64_t termNum;  // terms in the lexicon
+    uint64_t postingNum;  // postings over all lists
+    double avgDocLength;  // average words per document
+    uint32_t sourceCrc;  // CRC of the section CRCs of the file this one was built from (sourceCrcOf), 0 if none
+    uint32_t sectionNum;
+    FileSection sectionList[FORMAT_MAX_SECTIONS];
+    double scoreScale;  // BM25 score of one impact level (chunk upper bounds, and postings in impact mode)
+    double bm25K1, bm25B;  // BM25 parameters the impacts and chunk upper bounds were computed with
+    uint32_t reserved;
+    uint32_t headerCrc;  // CRC-32 of all the header bytes before this field
+};
+
+
+FileHeader newFileHeader(uint32_t magic);
+uint32_t crc32Of(const void *data, size_t length, uint32_t crc = 0);
+
+void writeHeaderPlaceholder(ofstream &outfile);  // reserves room for the header, sections follow
+void alignSection(ofstream &outfile);  // pads the file to the next 8-byte boundary
+void beginSection(FileHeader &header, uint32_t id, uint64_t offset);
+void endSection(FileHeader &header, uint64_t offset);
+bool finalizeFile(const string &path, FileHeader &header);  // computes the CRCs and writes the header
+
+// Validation at load time: magic, version, header CRC and section bounds (a truncated file fails here), which
+// only reads the header; the section CRCs too when FORMAT_VERIFY_CHECKSUM is on. Prints the reason and returns false on failure.
+bool readHeader(const string &path, uint32_t magic, FileHeader &header);
+const FileSection *findSection(const FileHeader &header, uint32_t id);
+uint32_t sourceCrcOf(const FileHeader &source);  // what a file built from source records as its sourceCrc
+bool checkSource(const FileHeader &header, const FileHeader &source, const string &path, const string &sourcePath);
+
+// Read-only shared mapping of a whole file, nullptr on failure; the page cache copy is shared between processes
+const uint8_t *mapFile(const string &path, size_t &size);
+void unmapFile(const uint8_t *data, size_t size);
+void adviseFile(const uint8_t *data, uint64_t offset, uint64_t length, int advice);  // madvise on the pages of a mapped range
+
+#endif //SEARCHSYSTEM_INDEXFORMAT_H
@@ -2,59 +2,11 @@
 // Created by Dong Li on 10/16/24.
 //
 #include "Lexicon.h"
+#include <cstring>
+#include <sys/mman.h>  // For madvise
 using namespace std;
 
 
-// Function to encode a uint32 value using Varbyte encoding
-vector<uint8_t> varbyteEncode(uint32_t value) {
-    vector<uint8_t> encoded;
-    while (value > 0) {
-        // Extract the 7 least significant bits
-        uint8_t byte = value & 0x7F;
-        // Set the high bit to indicate more bytes if needed
-        if (value > 0x7F)
-        {
-            byte |= 0x80;
-        }
-        encoded.push_back(byte);
-        // Shift the value to the right by 7 bits
-        value >>= 7;
-    }
-    return encoded;
-}
-
-
-// Function to decode a Varbyte encoded sequence into a uint32 value
-uint32_t varbyteDecode(const vector<uint8_t> &encoded) {
-    uint32_t value = 0;
-    for (size_t i = 0; i < encoded.size(); ++i) {
-        // Extract the 7 least significant bits from the byte
-        uint32_t byte = encoded[i] & 0x7F;
-        // Add the extracted bits to the result
-        value |= (byte << (7 * i));
-        // If the high bit is not set, it's the last byte
-        if (!(encoded[i] & 0x80)) {
-            break;
-        }
-    }
-    return value;
-}
-
-
-// Default constructor and destructor for LexiconItem
-LexiconItem::LexiconItem() = default;
-LexiconItem::~LexiconItem() = default;
-
-
-// Update the LexiconItem fields
-void LexiconItem::update(uint32_t beginPos, uint32_t endPos, uint32_t docNum, uint32_t blockNum) {
-    this->beginPos = beginPos;
-    this->endPos = endPos;
-    this->docNum = docNum;
-    this->blockNum = blockNum;
-}
-
-
 // Constructor for the Lexicon class, setting paths based on file mode (binary or ASCII)
 Lexicon::Lexicon() {
     if (FILE_MODE_BIN) {  // FILEMODE == BIN
@@ -68,7 +20,20 @@ Lexicon::Lexicon() {
 }
 
 
-Lexicon::~Lexicon() {  // Destructor - currently no dynamic memory to free
+Lexicon::~Lexicon() {
+    _unmapLexicon();
+}
+
+
+void Lexicon::_unmapLexicon() {
+    _dictionary.clear();
+    _termHash.clear();
+    unmapFile(_mapped, _mappedSize);
+    _mapped = nullptr;
+    _mappedSize = 0;
+    unmapFile(_indexMapped, _indexMappedSize);  // also before build() rewrites the index under the mapping
+    _indexMapped = nullptr;
+    _indexMappedSize = 0;
 }
 
 
@@ -84,194 +49,340 @@ uint32_t Lexicon::_getPostingDocNum(string idxWordList) {
 }
 
 
-// Insert a new entry into the lexicon map
-bool Lexicon::insert(string word, uint32_t beginPos, uint32_t endPos, uint32_t docNum, uint32_t blockNum) {
+// Append the next term to the dictionary, terms come in sorted order
+bool Lexicon::insert(string word, uint64_t beginPos, uint64_t endPos, uint32_t docNum, uint32_t blockNum, uint32_t codec, uint64_t skipPos, uint32_t maxLevel) {
     if (word.empty()) {
         return false;  // Avoid empty words
     }
     LexiconItem lexItem;
-    lexItem.update(beginPos, endPos, docNum, blockNum);  // Update lexicon item details
-    lexiconList[word] = lexItem;  // Insert into the lexicon map
+    lexItem.update(beginPos, endPos, docNum, blockNum, codec, skipPos, maxLevel);  // Update lexicon item details
+    return _dictionary.append(word, lexItem);
+}
+
+
+// One hash and one slot read; the sorted dictionary is only searched if the hash could not be built
+bool Lexicon::find(const string &term, LexiconItem &lexItem) const {
+    uint64_t termIdx;
+    bool found = _termHash.ready() ? _termHash.find(term, termIdx) : _dictionary.find(term, termIdx);
+    if (!found) {
+        return false;
+    }
+    lexItem = _dictionary.item(termIdx);
     return true;
 }
 
 
-// Write encoded blocks of postings to the index file and return the number of blocks
-uint32_t Lexicon::_writeBlocks(string term, uint32_t &docNum, string arr, ofstream &outfile) {
-    // Initialize position and lists for storing encoded docIDs and frequencies
-    size_t beginPos = 0;
-    vector<vector<uint8_t>> docIdList;  // Encoded docID list
-    vector<vector<uint8_t>> freqList;  // Encoded frequency list
-    vector<uint32_t> lastDocIdMetadata;  // Last docID of each block
-    vector<uint32_t> docIdBlockSizeMetadata;  // Sizes of docID blocks
-    vector<uint32_t> freqBlockSizeMetadata;  // Sizes of frequency blocks
+LexiconItem Lexicon::getItem(const string &term) const {
+    LexiconItem lexItem;
+    find(term, lexItem);
+    return lexItem;
+}
 
-    uint32_t docId;
-    uint32_t freq;
-    bool isDone = false;
-    uint32_t prevDocId = 0;  // Keeps track of the previous document ID for delta encoding
 
-    // Loop through the input postings string to extract and encode docIDs and frequencies
-    while (!isDone) {
-        size_t space, comma;
-        try {
-            // Extract docID and frequency from the postings list
-            space = arr.find(" ", beginPos);
-            comma = arr.find(",", space);
-            docId = stoi(arr.substr(beginPos, space - beginPos));  // Extract docID
-
-            if (comma != string::npos) {
-                freq = stoi(arr.substr(space + 1, comma - space - 1));  // Extract frequency
-            }
-            else {
-                freq = stoi(arr.substr(space + 1));  // Last frequency in the string
-                isDone = true;  // No more postings to process
-            }
+PostingStream::PostingStream(istream &in) : _buf(*in.rdbuf()), _done(false) {
+    _begin = _buf.pubseekoff(0, ios::cur, ios::in);
+}
+
+
+// Goes back to the first posting of the line, for another pass
+void PostingStream::rewind() {
+    _buf.pubseekpos(_begin, ios::in);
+    _done = false;
+}
 
-            // Encode docID as a difference (delta) from the previous docID using VarByte encoding
-            if (docId < prevDocId) {
-                cout << "Unexpected: DocId not ordered properly!" << endl;
-            }
 
-            vector<uint8_t> enDocId = varbyteEncode(docId - prevDocId);
-            vector<uint8_t> enFreq = varbyteEncode(freq);  // Encode frequency
-            docIdList.push_back(enDocId);  // Store encoded docID
-            freqList.push_back(enFreq);  // Store encoded frequency
-            prevDocId = docId;  // Update previous docID
+// Reads digits up to the next non-digit character, which is consumed and returned
+int PostingStream::_readNumber(uint32_t &value) {
+    value = 0;
+    int c = _buf.sbumpc();
+    while (c >= '0' && c <= '9') {
+        value = value * 10 + (c - '0');
+        c = _buf.sbumpc();
+    }
+    return c;
+}
 
-            // Store metadata for each block if it's full or we are at the end of the postings
-            if (docIdList.size() % POSTINGS_PER_CHUNK == 0 || isDone) {
-                lastDocIdMetadata.push_back(docId);  // Store last docID of this block
-                prevDocId = 0;  // Reset for the next block
+
+bool PostingStream::next(uint32_t &docId, uint32_t &freq) {
+    if (_done) {
+        return false;
+    }
+    int separator = _readNumber(docId);
+    if (separator != ' ') {
+        _done = true;  // empty or malformed line
+        if (separator != '\n' && separator != '\r' && separator != EOF) {
+            cout << "Unexpected: malformed posting, rest of the line skipped" << endl;
+            while (separator != '\n' && separator != EOF) {
+                separator = _buf.sbumpc();
             }
         }
-        catch (...) {
-            cout << arr.substr(beginPos, space - beginPos) << " " << arr.substr(space + 1, comma - space - 1);
-            cout << arr.substr(beginPos, space - beginPos).length() << endl;
-            cout << arr.substr(space + 1, comma - space - 1).length() << endl;
-            continue;
-        }
-        beginPos = comma + 1;  // Move to the next docID in the postings list
+        return false;
     }
+    separator = _readNumber(freq);
+    if (separator == '\r') {
+        separator = _buf.sbumpc();
+    }
+    _done = (separator != ',');  // the last posting ends the line
+    return true;
+}
 
-    docNum = docIdList.size();  // Total number of postings (docID-frequency pairs)
-
-    // Calculate sizes for the metadata (docID block size and frequency block size)
-    uint32_t docIdSize = 0, freqSize = 0;
-    for (int i = 0; i < docIdList.size(); i++) {
-        docIdSize += docIdList[i].size();  // Sum size of encoded docIDs
-        freqSize += freqList[i].size();  // Sum size of encoded frequencies
 
-        // If block is full, store the block sizes
-        if ((i + 1) % POSTINGS_PER_CHUNK == 0 || i == docIdList.size() - 1) {
-            docIdBlockSizeMetadata.push_back(docIdSize);  // Store docID block size
-            freqBlockSizeMetadata.push_back(freqSize);  // Store frequency block size
-            docIdSize = 0;
-            freqSize = 0;  // Reset for the next block
+// Reads up to POSTINGS_PER_CHUNK postings as docID gaps (the first one absolute) and frequencies
+bool Lexicon::_readChunk(PostingStream &postings, vector<uint32_t> &chunkDocIds, vector<uint32_t> &chunkFreqs, uint32_t &lastDocId) {
+    chunkDocIds.clear();
+    chunkFreqs.clear();
+    uint32_t docId, freq;
+    uint32_t prevDocId = 0;  // Keeps track of the previous document ID for delta encoding
+    while (chunkDocIds.size() < POSTINGS_PER_CHUNK && postings.next(docId, freq)) {
+        if (docId < prevDocId) {
+            cout << "Unexpected: DocId not ordered properly!" << endl;
         }
+        chunkDocIds.push_back(docId - prevDocId);  // Store docID gap
+        chunkFreqs.push_back(freq);  // Store frequency
+        prevDocId = docId;  // Update previous docID
+        lastDocId = docId;
     }
+    return !chunkDocIds.empty();
+}
 
-    // Write the blocks of postings and their metadata to the output file
-    int numBlocks = (int)lastDocIdMetadata.size();  // Total number of blocks
-    int currBlockIdx = 0;  // Pointer to track blocks written so far
 
+// Write encoded blocks of postings to the index file and return the number of blocks
+// The postings are streamed: only the current chunk and the current block are held in memory,
+// and each finished block goes to the file with a single write
+uint32_t Lexicon::_writeBlocks(string term, uint32_t docNum, uint32_t codec, PostingStream &postings, ofstream &outfile,
+                              uint32_t &listMaxLevel) {
+    vector<uint32_t> chunkDocIds, chunkFreqs;  // Raw docID gaps and frequencies of the current chunk
+    chunkDocIds.reserve(POSTINGS_PER_CHUNK);
+    chunkFreqs.reserve(POSTINGS_PER_CHUNK);
+    vector<uint8_t> enDocIds, enFreqs;  // Encoded current chunk
+    vector<uint8_t> blockData;  // Encoded chunks of the current block
+    vector<uint8_t> blockBuffer;  // The block as written: metadata, then the chunks
+    vector<uint32_t> lastDocIdMetadata;  // Last docID of each block
+    vector<uint32_t> docIdBlockSizeMetadata;  // Sizes of docID blocks
+    vector<uint32_t> freqBlockSizeMetadata;  // Sizes of frequency blocks
+    vector<uint8_t> chunkMaxLevels;  // Score upper bound of each block, in impact levels
+    uint32_t blockFirstDocId = 0;
+    listMaxLevel = 0;
     uint32_t totalBlocks = 0;  // Total number of blocks
 
-    // Pack as many blocks as possible into the current buffer size (BLOCK_SIZE)
-    while (currBlockIdx < numBlocks) {
-        uint32_t writtenBlockSize = 4;  // Start with 4 bytes for block length
-        int startBlockIdx = currBlockIdx;
+    auto append = [&blockBuffer](const void *data, size_t size) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        blockBuffer.insert(blockBuffer.end(), bytes, bytes + size);
+    };
+
+    // Write the metadata (last docIDs, docID and frequency sizes) and the chunks of the current block
+    auto flushBlock = [&]() {
+        uint32_t blockLen = lastDocIdMetadata.size();
+        _skipList.push_back({_indexPos, blockFirstDocId, lastDocIdMetadata.back(), (uint32_t)_skipChunkList.size(), blockLen});
+        _skipChunkList.insert(_skipChunkList.end(), lastDocIdMetadata.begin(), lastDocIdMetadata.end());
+        _skipChunkMaxList.insert(_skipChunkMaxList.end(), chunkMaxLevels.begin(), chunkMaxLevels.end());
+
+        blockBuffer.clear();
+        append(&blockLen, sizeof(uint32_t));
+        append(lastDocIdMetadata.data(), blockLen * sizeof(uint32_t));
+        append(docIdBlockSizeMetadata.data(), blockLen * sizeof(uint32_t));
+        append(freqBlockSizeMetadata.data(), blockLen * sizeof(uint32_t));
+        append(blockData.data(), blockData.size());
+        outfile.write(reinterpret_cast<const char *>(blockBuffer.data()), blockBuffer.size());
+        _indexPos += blockBuffer.size();
+        totalBlocks += 1;
 
-        // Pack as many blocks as possible into the current buffer size (BLOCK_SIZE)
-        while (writtenBlockSize <= BLOCK_SIZE && currBlockIdx < numBlocks) {
-            uint32_t nextBlockSize = 4 * 3 + docIdBlockSizeMetadata[currBlockIdx] + freqBlockSizeMetadata[currBlockIdx];
-            if (writtenBlockSize + nextBlockSize > BLOCK_SIZE) {
-                break;  // Stop if the new block doesn't fit
+        lastDocIdMetadata.clear();
+        docIdBlockSizeMetadata.clear();
+        freqBlockSizeMetadata.clear();
+        chunkMaxLevels.clear();
+        blockData.clear();
+    };
+
+    uint32_t lastDocId;
+    while (_readChunk(postings, chunkDocIds, chunkFreqs, lastDocId)) {
+        // Replace every frequency with the posting's quantized BM25 impact, and bound the chunk's scores
+        uint32_t chunkDocId = 0, maxLevel = 0;
+        for (size_t j = 0; j < chunkDocIds.size(); j++) {
+            chunkDocId += chunkDocIds[j];
+            if (IMPACT_MODE) {
+                chunkFreqs[j] = _pageTable->quantizeImpact(_pageTable->getBM25(chunkDocId, docNum, chunkFreqs[j]));
             }
-            currBlockIdx += 1;
-            writtenBlockSize += nextBlockSize;  // Update current byte count
+            uint32_t level = IMPACT_MODE ? chunkFreqs[j]
+                                         : _pageTable->quantizeImpactUp(_pageTable->getBM25(chunkDocId, docNum, chunkFreqs[j]));
+            maxLevel = max(maxLevel, level);
         }
 
-        // Write metadata for the current block (docIDs, block sizes)
-        totalBlocks += 1;
-        uint32_t blockLen = currBlockIdx - startBlockIdx;
-        outfile.write(reinterpret_cast<const char *>(&blockLen), sizeof(uint32_t));  // Write block length
+        enDocIds.clear();
+        enFreqs.clear();
+        encodeChunk(codec, chunkDocIds.data(), chunkDocIds.size(), enDocIds);
+        encodeChunk(freqCodec(codec), chunkFreqs.data(), chunkFreqs.size(), enFreqs);
 
-        // Write last docID, docID block sizes, and frequency block sizes for each block
-        for (int i = startBlockIdx; i < currBlockIdx; i++) {
-            outfile.write(reinterpret_cast<const char *>(&lastDocIdMetadata[i]), sizeof(uint32_t));
-            // if(term=="0") cout << metadata_last_docID[i] << " ";
-        }
-        // if(term=="0") cout << endl;
-        for (int i = startBlockIdx; i < currBlockIdx; i++) {
-            outfile.write(reinterpret_cast<const char *>(&docIdBlockSizeMetadata[i]), sizeof(uint32_t));
-            // if(term=="0") cout<<metadata_docID_block_sizes[i]<<" ";
+        // Start a new block when the chunk does not fit in BLOCK_SIZE with its 3 metadata integers
+        size_t blockSize = 4 + 12 * (lastDocIdMetadata.size() + 1) + blockData.size() + enDocIds.size() + enFreqs.size();
+        if (!lastDocIdMetadata.empty() && blockSize > BLOCK_SIZE) {
+            flushBlock();
         }
-        // if(term=="0") cout << endl;
-        for (int i = startBlockIdx; i < currBlockIdx; i++) {
-            outfile.write(reinterpret_cast<const char *>(&freqBlockSizeMetadata[i]), sizeof(uint32_t));
-            // if(term=="0") cout << metadata_freq_block_sizes[i] << " ";
-        }
-
-        // Write the actual postings (docID and frequency pairs)
-        for (int i = startBlockIdx; i < currBlockIdx; i++) {
-            // Write encoded docIDs for each block
-            for (int j = i * POSTINGS_PER_CHUNK; j < (i + 1) * POSTINGS_PER_CHUNK && j < docIdList.size(); j++) {
-                vector<uint8_t> enDocId = docIdList[j];
-                for (unsigned char & k : enDocId) {  // Write each byte
-                    outfile.write(reinterpret_cast<const char *>(&k), sizeof(uint8_t));
-                }
-            }
-            // Write encoded frequencies for each block
-            for (int j = i * POSTINGS_PER_CHUNK; j < (i + 1) * POSTINGS_PER_CHUNK && j < docIdList.size(); j++) {
-                vector<uint8_t> enFreq = freqList[j];
-                for (unsigned char & k : enFreq) {  // Write each byte
-                    outfile.write(reinterpret_cast<const char *>(&k), sizeof(uint8_t));
-                }
-            }
+        if (lastDocIdMetadata.empty()) {
+            blockFirstDocId = chunkDocIds[0];  // the first gap of a chunk is absolute
         }
+        lastDocIdMetadata.push_back(lastDocId);
+        docIdBlockSizeMetadata.push_back(enDocIds.size());
+        freqBlockSizeMetadata.push_back(enFreqs.size());
+        chunkMaxLevels.push_back(maxLevel);
+        listMaxLevel = max(listMaxLevel, maxLevel);
+        blockData.insert(blockData.end(), enDocIds.begin(), enDocIds.end());
+        blockData.insert(blockData.end(), enFreqs.begin(), enFreqs.end());
+    }
+    if (!lastDocIdMetadata.empty()) {
+        flushBlock();
     }
 
     return totalBlocks;  // Return the total number of blocks written
 }
 
 
+// Write the Roaring containers of a dense list after its blocks, 8-byte aligned so bitmaps can be read in place.
+// Streamed like the blocks: one pass counts the containers, whose directory comes first, the next one writes them
+void Lexicon::_writeContainers(uint64_t listBegin, PostingStream &postings, ofstream &outfile, uint64_t *typeCount) {
+    uint32_t docId, freq, containerNum = 0, key = UINT32_MAX;
+    postings.rewind();
+    while (postings.next(docId, freq)) {
+        containerNum += docId >> 16 != key;
+        key = docId >> 16;
+    }
+
+    char padding[8] = {0};
+    outfile.write(padding, (8 - _indexPos % 8) % 8);
+    _indexPos += (8 - _indexPos % 8) % 8;
+    RoaringWriter writer(outfile, containerNum, typeCount);
+    postings.rewind();
+    while (postings.next(docId, freq)) {
+        writer.add(docId);
+    }
+    _denseList.push_back({listBegin, _indexPos});
+    _indexPos += writer.finish();
+}
+
+
 // Build function that processes a single merged file
-void Lexicon::build(const string& mergedIndexPath) {
+void Lexicon::build(const string& mergedIndexPath, const PageTable &pageTable) {
+    _pageTable = &pageTable;
     ifstream infile;
     ofstream outfile;
     // Open the merged index file for reading and the final index file for writing
     infile.open(mergedIndexPath, FILE_MODE_BIN ? ifstream::binary : ifstream::in);
     outfile.open(indexPath, FILE_MODE_BIN ? ifstream::binary : ifstream::in);
-    uint32_t beginPos = 0;  // Variables to track the positions of the postings in the index file
-    uint32_t endPos;  // Variables to track the positions of the postings in the index file
-    string line;
-
-
-    // Read the merged index file line by line
-    while (!infile.eof()) {
-        getline(infile, line);  // Read each line (term and postings)
-        string word = line.substr(0, line.find(":"));   // Extract the term (before the colon)
-        if (!word.length()) {
+    writeHeaderPlaceholder(outfile);
+    indexHeader = newFileHeader(FORMAT_MAGIC_INDEX);
+    _indexPos = outfile.tellp();
+    uint64_t beginPos = _indexPos;  // Variables to track the positions of the postings in the index file
+    uint64_t endPos;  // Variables to track the positions of the postings in the index file
+    beginSection(indexHeader, SECTION_POSTINGS, beginPos);
+    uint32_t codecListNum[CODEC_NUM] = {0};  // lists per codec
+    _skipList.clear();
+    _skipChunkList.clear();
+    _skipChunkMaxList.clear();
+    _denseList.clear();
+    uint64_t containerTypeNum[ROARING_RUN + 1] = {0};
+    _unmapLexicon();
+
+    vector<uint32_t> chunkDocIds, chunkFreqs;
+    string word;
+
+    // Read the merged index file term by term ("term:docId freq,docId freq,...")
+    while (getline(infile, word, ':')) {
+        if (!word.length() || word[0] == '\n') {
             break;  // If no word is found, exit the loop
         }
-        string arr = line.substr(line.find(":") + 1);   // Extract the postings list (after the colon)
+        PostingStream postings(infile);
 
-        uint32_t docNum;
+        // First pass: the document frequency, which the impacts and score bounds depend on
+        uint32_t docNum = 0, docId, freq;
+        while (postings.next(docId, freq)) {
+            docNum += 1;
+        }
+        postings.rewind();
+
+        // Second pass, for CODEC_AUTO only: the codec that fits this list best
+        uint32_t codec = POSTING_CODEC;
+        if (codec == CODEC_AUTO) {
+            CodecChooser chooser;
+            uint32_t lastDocId;
+            while (_readChunk(postings, chunkDocIds, chunkFreqs, lastDocId)) {
+                if (IMPACT_MODE) {
+                    uint32_t chunkDocId = 0;
+                    for (size_t j = 0; j < chunkDocIds.size(); j++) {
+                        chunkDocId += chunkDocIds[j];
+                        chunkFreqs[j] = _pageTable->quantizeImpact(_pageTable->getBM25(chunkDocId, docNum, chunkFreqs[j]));
+                    }
+                }
+                chooser.add(chunkDocIds.data(), chunkFreqs.data(), chunkDocIds.size());
+            }
+            codec = chooser.choose();
+            postings.rewind();
+        }
+
+        uint64_t skipPos = _skipList.size();
         // Write the blocks of postings for this word and get the number of blocks
-        uint32_t blockNum = _writeBlocks(word, docNum, arr, outfile);
+        uint32_t maxLevel;
+        uint32_t blockNum = _writeBlocks(word, docNum, codec, postings, outfile, maxLevel);
+        codecListNum[codec] += 1;
+        if (ROARING_MODE && (uint64_t)docNum * ROARING_MIN_DOC_RATIO >= pageTable.totalDoc) {
+            _writeContainers(beginPos, postings, outfile, containerTypeNum);
+        }
 
         // Update the lexicon with the term's metadata (begin/end positions, docNum, blockNum)
-        endPos = outfile.tellp();   // Get the current position (end of the postings for this word)
+        endPos = _indexPos;   // Get the current position (end of the postings for this word)
         if (DEBUG_MODE and blockNum > 1) {
             cout << word << " " << beginPos << " " << endPos << " " << docNum << " " << blockNum << endl;
         }
-        insert(word, beginPos, endPos, docNum, blockNum);   // Insert the term and its metadata into the lexicon
+        insert(word, beginPos, endPos, docNum, blockNum, codec, skipPos, maxLevel);   // Insert the term and its metadata into the lexicon
         beginPos = endPos;  // Update the starting position for the next term
+        indexHeader.postingNum += docNum;
     }
 
     // Close the input and output files    infile.close();
+    endSection(indexHeader, beginPos);
+    _dictionary.finish(beginPos);
+    _termHash.build(_dictionary);
+
+    // The skip directory follows the postings
+    beginSection(indexHeader, SECTION_SKIP_BLOCKS, outfile.tellp());
+    outfile.write(reinterpret_cast<const char *>(_skipList.data()), _skipList.size() * sizeof(SkipEntry));
+    endSection(indexHeader, outfile.tellp());
+    beginSection(indexHeader, SECTION_SKIP_CHUNKS, outfile.tellp());
+    outfile.write(reinterpret_cast<const char *>(_skipChunkList.data()), _skipChunkList.size() * sizeof(uint32_t));
+    endSection(indexHeader, outfile.tellp());
+    beginSection(indexHeader, SECTION_SKIP_CHUNK_MAX, outfile.tellp());
+    outfile.write(reinterpret_cast<const char *>(_skipChunkMaxList.data()), _skipChunkMaxList.size());
+    endSection(indexHeader, outfile.tellp());
+    beginSection(indexHeader, SECTION_DENSE_LISTS, outfile.tellp());
+    outfile.write(reinterpret_cast<const char *>(_denseList.data()), _denseList.size() * sizeof(DenseListEntry));
+    endSection(indexHeader, outfile.tellp());
+    uint64_t indexBytes = outfile.tellp();
     outfile.close();
+
+    // Record what the postings depend on: flags, codec and the collection they were built over
+    indexHeader.flags = (IMPACT_MODE ? FORMAT_FLAG_IMPACT : 0) | (BM25_NORM_BYTES ? FORMAT_FLAG_NORM_BYTES : 0);
+    indexHeader.codec = POSTING_CODEC;
+    indexHeader.impactLevels = IMPACT_MODE ? IMPACT_LEVELS : 0;
+    indexHeader.docNum = pageTable.totalDoc;
+    indexHeader.termNum = _dictionary.size();
+    indexHeader.avgDocLength = pageTable.avgWordCount;
+    indexHeader.scoreScale = pageTable.getImpactScale();
+    indexHeader.bm25K1 = pageTable.bm25K1;
+    indexHeader.bm25B = pageTable.bm25B;
+    if (pageTable.header.sectionNum > 0) {
+        indexHeader.sourceCrc = sourceCrcOf(pageTable.header);
+    }
+    finalizeFile(indexPath, indexHeader);
+
+    cout << "Final index: " << indexHeader.postingNum << " postings in " << indexBytes / 1024 << " KB" << endl;
+    cout << "Lists per codec:";
+    for (uint32_t codec = 0; codec < CODEC_NUM; codec++) {
+        cout << " " << codecName(codec) << " " << codecListNum[codec];
+    }
+    cout << endl;
+    if (ROARING_MODE) {
+        cout << "Dense lists: " << _denseList.size() << " with Roaring containers (bitmap " << containerTypeNum[ROARING_BITMAP]
+             << ", array " << containerTypeNum[ROARING_ARRAY] << ", run " << containerTypeNum[ROARING_RUN] << ")" << endl;
+    }
 }
 
 
@@ -287,54 +398,136 @@ void Lexicon::write() {
         outfile.open(_lexiconPath);
     }
 
-    // Write each term and its metadata (begin/end positions, docNum) from the lexicon map
-    for (const auto& [word, lexItem] : lexiconList) {
-        outfile << word << " " << lexItem.beginPos << " " << lexItem.endPos << " "
-                << lexItem.docNum << " " << lexItem.blockNum << endl;
-    }
-
+    // The dictionary image is written as is, loading reads it back without parsing
+    writeHeaderPlaceholder(outfile);
+    header = newFileHeader(FORMAT_MAGIC_LEXICON);
+    beginSection(header, SECTION_TERMS, outfile.tellp());
+    outfile.write(reinterpret_cast<const char *>(_dictionary.image()), _dictionary.imageSize());
+    endSection(header, outfile.tellp());
+    beginSection(header, SECTION_TERM_HASH, outfile.tellp());
+    outfile.write(reinterpret_cast<const char *>(_termHash.image()), _termHash.imageSize());
+    endSection(header, outfile.tellp());
     outfile.close();    // Close the lexicon file
+
+    // The lexicon belongs to the index written by the last build()
+    header.flags = indexHeader.flags;
+    header.codec = indexHeader.codec;
+    header.impactLevels = indexHeader.impactLevels;
+    header.docNum = indexHeader.docNum;
+    header.termNum = _dictionary.size();
+    header.postingNum = indexHeader.postingNum;
+    header.avgDocLength = indexHeader.avgDocLength;
+    header.scoreScale = indexHeader.scoreScale;
+    header.bm25K1 = indexHeader.bm25K1;
+    header.bm25B = indexHeader.bm25B;
+    header.sourceCrc = sourceCrcOf(indexHeader);
+    finalizeFile(_lexiconPath, header);
 }
 
 
 void Lexicon::load() {
-    ifstream infile;
     if (DEBUG_MODE) {
         cout << "lexicon file path: " << _lexiconPath << endl;
     }
-    if (FILE_MODE_BIN) {
-        infile.open(_lexiconPath, ifstream::binary);
+    // Both files must be intact, belong together and match the scoring mode of this build
+    if (!readHeader(_lexiconPath, FORMAT_MAGIC_LEXICON, header) || !readHeader(indexPath, FORMAT_MAGIC_INDEX, indexHeader)
+        || !checkSource(header, indexHeader, _lexiconPath, indexPath)) {
+        exit(1);
     }
-    else {
-        infile.open(_lexiconPath);
+    if (((indexHeader.flags & FORMAT_FLAG_IMPACT) != 0) != (IMPACT_MODE != 0)) {
+        cerr << indexPath << (IMPACT_MODE ? " stores frequencies" : " stores impacts")
+             << ", rebuild it or change IMPACT_MODE" << endl;
+        exit(1);
     }
-    if (!infile) {
-        cout << "can not read " << _lexiconPath << endl;
-        exit(0);
+
+    // The dictionary is read in place from the mapped file: nothing is parsed or copied, and
+    // every server process on the machine shares the same page cache pages
+    _unmapLexicon();
+    _mapped = mapFile(_lexiconPath, _mappedSize);
+    if (!_mapped) {
+        exit(1);
     }
-    lexiconList.clear();
-
-    bool firstOccurrence[26] = {false};  // for debug purpose
-
-    while (!infile.eof()) {
-        string term;
-        LexiconItem lexItem;
-        infile >> term;
-        infile >> lexItem.beginPos >> lexItem.endPos >> lexItem.docNum >> lexItem.blockNum;
-        if (DEBUG_MODE) {
-            char firstChar = tolower(term[0]);
-            if (firstChar >= 'a' && firstChar <= 'z') {
-                int index = firstChar - 'a';
-                if (!firstOccurrence[index]) {
-                    firstOccurrence[index] = true;
-                    if (DEBUG_MODE) {
-                        cout << "read lexiconItem: " << term << " " << lexItem.beginPos << " "
-                             << lexItem.endPos << " " << lexItem.docNum << " " << lexItem.blockNum << endl;
-                    }
-                }
-            }
-        }
-        lexiconList[term] = lexItem;
+
+    const FileSection *terms = findSection(header, SECTION_TERMS);
+    const FileSection *termHash = findSection(header, SECTION_TERM_HASH);
+    if (!terms || !_dictionary.open(_mapped + terms->offset, terms->size) || _dictionary.size() != header.termNum
+        || !termHash || !_termHash.open(_mapped + termHash->offset, termHash->size) || _termHash.size() != header.termNum) {
+        cerr << _lexiconPath << ": corrupted term dictionary, rebuild the index" << endl;
+        exit(1);
+    }
+    if (DEBUG_MODE && _dictionary.size() > 0) {
+        LexiconItem lexItem = _dictionary.item(0);
+        cout << "read lexiconItem: " << _dictionary.term(0) << " " << lexItem.beginPos << " "
+             << lexItem.endPos << " " << lexItem.docNum << " " << lexItem.blockNum << endl;
+    }
+    cout << "There are " << _dictionary.size() << " words in Lexicon Structure" << endl;
+
+    // The index is mapped once for the life of the server; queries touch scattered chunks of few lists,
+    // so read-ahead is off and the lists decoded in full ask for their own pages (adviseList)
+    _indexMapped = mapFile(indexPath, _indexMappedSize);
+    if (!_indexMapped) {
+        exit(1);
+    }
+    adviseFile(_indexMapped, 0, _indexMappedSize, MADV_RANDOM);
+
+    _loadSkipDirectory();
+}
+
+
+// Copies the skip directory and dense list sections out of the mapped index
+void Lexicon::_loadSkipDirectory() {
+    const FileSection *blocks = findSection(indexHeader, SECTION_SKIP_BLOCKS);
+    const FileSection *chunks = findSection(indexHeader, SECTION_SKIP_CHUNKS);
+    const FileSection *chunkMax = findSection(indexHeader, SECTION_SKIP_CHUNK_MAX);
+    const FileSection *dense = findSection(indexHeader, SECTION_DENSE_LISTS);
+    if (!blocks || !chunks || !chunkMax || !dense) {
+        cerr << indexPath << ": no skip directory, rebuild the index" << endl;
+        exit(1);
+    }
+    _skipList.resize(blocks->size / sizeof(SkipEntry));
+    _skipChunkList.resize(chunks->size / sizeof(uint32_t));
+    _skipChunkMaxList.resize(chunkMax->size);
+    _denseList.resize(dense->size / sizeof(DenseListEntry));
+    memcpy(_skipList.data(), _indexMapped + blocks->offset, _skipList.size() * sizeof(SkipEntry));
+    memcpy(_skipChunkList.data(), _indexMapped + chunks->offset, _skipChunkList.size() * sizeof(uint32_t));
+    memcpy(_skipChunkMaxList.data(), _indexMapped + chunkMax->offset, chunkMax->size);
+    memcpy(_denseList.data(), _indexMapped + dense->offset, _denseList.size() * sizeof(DenseListEntry));
+    if (DEBUG_MODE) {
+        cout << "skip directory: " << _skipList.size() << " blocks, " << _skipChunkList.size() << " chunks, "
+             << _denseList.size() << " dense lists" << endl;
+    }
+}
+
+
+SkipDirectory Lexicon::skipDirectory(const LexiconItem &lexItem) const {
+    SkipDirectory skips;
+    if (lexItem.blockNum == 0) {
+        return skips;
+    }
+    skips.blockList = &_skipList[lexItem.skipPos];
+    skips.blockNum = lexItem.blockNum;
+    const SkipEntry &first = skips.blockList[0];
+    const SkipEntry &last = skips.blockList[lexItem.blockNum - 1];
+    skips.chunkLastList = &_skipChunkList[first.chunkPos];
+    skips.chunkNum = last.chunkPos + last.chunkNum - first.chunkPos;
+    skips.chunkMaxList = &_skipChunkMaxList[first.chunkPos];
+    skips.maxLevel = lexItem.maxLevel;
+    skips.scoreScale = IMPACT_MODE ? 1.0 : indexHeader.scoreScale;  // impact mode scores are sums of levels
+    return skips;
+}
+
+
+bool Lexicon::findContainers(const LexiconItem &lexItem, uint64_t &offset) const {
+    auto it = lower_bound(_denseList.begin(), _denseList.end(), lexItem.beginPos,
+                          [](const DenseListEntry &entry, uint64_t pos) { return entry.listBegin < pos; });
+    if (lexItem.blockNum == 0 || it == _denseList.end() || it->listBegin != lexItem.beginPos) {
+        return false;
     }
-    cout << "There are " << lexiconList.size() << " words in Lexicon Structure" << endl;
-}
\ No newline at end of file
+    offset = it->offset;
+    return true;
+}
+
+
+void Lexicon::adviseList(const LexiconItem &lexItem, int advice) const {
+    adviseFile(_indexMapped, lexItem.beginPos, lexItem.endPos - lexItem.beginPos, advice);
+}
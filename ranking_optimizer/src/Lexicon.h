@@ -6,37 +6,79 @@
 #define SEARCHSYSTEM_LEXICON_H
 
 #include "config.h"
+#include "PostingCodec.h"
+#include "PageTable.h"
+#include "RoaringList.h"
+#include "SkipDirectory.h"
+#include "TermDictionary.h"
+#include "TermHash.h"
 using namespace std;
 
 
-class LexiconItem {
+// Postings of one merged index line ("docId freq,docId freq,...\n"), parsed straight from the stream so
+// that a list is never held in memory; rewind() goes back to the first posting for another pass
+class PostingStream {
+private:
+    streambuf &_buf;
+    streampos _begin;
+    bool _done;
+
+    int _readNumber(uint32_t &value);
+
 public:
-    uint32_t beginPos{}; // begin offset
-    uint32_t endPos{};   // end offset
-    uint32_t docNum{};
-    uint32_t blockNum{};
-
-    LexiconItem();
-    ~LexiconItem();
-    void update(uint32_t, uint32_t, uint32_t, uint32_t);
+    explicit PostingStream(istream &in);
+    bool next(uint32_t &docId, uint32_t &freq);  // false after the last posting of the line
+    void rewind();
 };
 
+
 class Lexicon {
 private:
 //    string _indexPath;
     string _lexiconPath;
+    const PageTable *_pageTable = nullptr;  // document lengths for IMPACT_MODE, set during build
+    vector<SkipEntry> _skipList;  // blocks of all terms, in lexicon order
+    vector<uint32_t> _skipChunkList;  // last docID of every chunk of all terms
+    vector<uint8_t> _skipChunkMaxList;  // score upper bound of every chunk of all terms, in impact levels
+    vector<DenseListEntry> _denseList;  // lists with Roaring containers, in lexicon order
     uint32_t _getPostingDocNum(string); //calc Doc Num
-    uint32_t _writeBlocks(string, uint32_t&, string, ofstream &);
+    uint64_t _indexPos = 0;  // bytes written to the index file so far, during build
+    bool _readChunk(PostingStream &, vector<uint32_t> &, vector<uint32_t> &, uint32_t &);
+    uint32_t _writeBlocks(string, uint32_t, uint32_t, PostingStream &, ofstream &, uint32_t &);  // also returns the list's max level
+    void _writeContainers(uint64_t listBegin, PostingStream &, ofstream &, uint64_t *typeCount);
+    void _loadSkipDirectory();
+    TermDictionary _dictionary;  // terms in sorted order with their metadata
+    TermHash _termHash;  // term -> dictionary index
+    const uint8_t *_mapped = nullptr;  // the lexicon file, mapped read-only by load()
+    size_t _mappedSize = 0;
+    const uint8_t *_indexMapped = nullptr;  // the index file, mapped read-only by load()
+    size_t _indexMappedSize = 0;
+    void _unmapLexicon();
 
 public:
-    map<string, LexiconItem> lexiconList;
     string indexPath;
+    FileHeader header;  // format header of the lexicon file
+    FileHeader indexHeader;  // format header of the index file the lexicon points into
     Lexicon();
     ~Lexicon();
-    bool insert(string, uint32_t, uint32_t, uint32_t, uint32_t);
-    void build(const string& mergedIndexPath);
+    Lexicon(const Lexicon &) = delete;  // owns the mappings of the lexicon and index files
+    Lexicon &operator=(const Lexicon &) = delete;
+    bool insert(string, uint64_t, uint64_t, uint32_t, uint32_t, uint32_t, uint64_t, uint32_t);
+    void build(const string& mergedIndexPath, const PageTable &pageTable);
     void write();
     void load();
+    SkipDirectory skipDirectory(const LexiconItem &lexItem) const;
+    const uint8_t *indexData() const { return _indexMapped; }  // the whole index file, every decode path reads from here
+    uint64_t indexSize() const { return _indexMappedSize; }
+    void adviseList(const LexiconItem &lexItem, int advice) const;  // madvise on the postings of one list
+    bool findContainers(const LexiconItem &lexItem, uint64_t &offset) const;  // Roaring containers of a dense list, up to endPos
+
+    // Lookups never modify the lexicon: an unknown term is just not found
+    uint64_t size() const { return _dictionary.size(); }
+    bool find(const string &term, LexiconItem &lexItem) const;
+    LexiconItem getItem(const string &term) const;  // empty item (docNum 0) for an unknown term
+    string termAt(uint64_t termIdx) const { return _dictionary.term(termIdx); }
+    LexiconItem itemAt(uint64_t termIdx) const { return _dictionary.item(termIdx); }
 };
 
 #endif //SEARCHSYSTEM_LEXICON_H
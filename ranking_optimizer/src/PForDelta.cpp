@@ -0,0 +1,240 @@
+#include "PForDelta.h"
+#include <cstring>
+#include <utility>
+#include <array>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+static const size_t PFOR_LANES = 4;  // 32-bit lanes of one SIMD register
+static const size_t PFOR_VERTICAL_SIZE = 64;  // chunks of exactly this many values are packed vertically
+static const size_t PFOR_HEADER_SIZE = 3;  // value count, bit width, exception count
+
+
+static inline uint32_t bitWidth(uint32_t value) {
+    return value ? 32 - __builtin_clz(value) : 0;
+}
+
+
+static inline size_t varbyteLength(uint32_t value) {
+    size_t len = 1;
+    while (value > 0x7F) {
+        value >>= 7;
+        len++;
+    }
+    return len;
+}
+
+
+// Bytes of the packed low bits; vertical lanes round up to whole 32-bit words
+static inline size_t packedBytes(size_t n, uint32_t b) {
+    if (n == PFOR_VERTICAL_SIZE) {
+        return PFOR_LANES * 4 * ((PFOR_VERTICAL_SIZE / PFOR_LANES * b + 31) / 32);
+    }
+    return (n * b + 7) / 8;
+}
+
+
+// Picks the bit width with the smallest chunk: larger widths cost packed bits, smaller ones exceptions
+static uint32_t chooseBitWidth(const uint32_t *in, size_t n, size_t &chunkBytes) {
+    uint32_t maxBits = 0;
+    for (size_t i = 0; i < n; i++) {
+        maxBits = max(maxBits, bitWidth(in[i]));
+    }
+
+    uint32_t bestWidth = maxBits;
+    chunkBytes = PFOR_HEADER_SIZE + packedBytes(n, maxBits);
+    for (int b = (int)maxBits - 1; b >= 0; b--) {
+        size_t bytes = PFOR_HEADER_SIZE + packedBytes(n, b);
+        for (size_t i = 0; i < n && bytes < chunkBytes; i++) {
+            if (bitWidth(in[i]) > (uint32_t)b) {
+                bytes += 1 + varbyteLength(in[i] >> b);
+            }
+        }
+        if (bytes < chunkBytes) {
+            chunkBytes = bytes;
+            bestWidth = b;
+        }
+    }
+    return bestWidth;
+}
+
+
+size_t pforChunkBytes(const uint32_t *in, size_t n) {
+    size_t chunkBytes;
+    chooseBitWidth(in, n, chunkBytes);
+    return chunkBytes;
+}
+
+
+size_t pforEncode(const uint32_t *in, size_t n, vector<uint8_t> &out) {
+    size_t chunkBytes;
+    uint32_t b = chooseBitWidth(in, n, chunkBytes);
+    uint32_t lowMask = (b == 32) ? 0xFFFFFFFF : ((1u << b) - 1);
+    size_t begin = out.size();
+
+    vector<uint8_t> positions;
+    vector<uint32_t> highParts;
+    for (size_t i = 0; i < n; i++) {
+        if (bitWidth(in[i]) > b) {
+            positions.push_back(i);
+            highParts.push_back(in[i] >> b);
+        }
+    }
+
+    out.push_back(n);
+    out.push_back(b);
+    out.push_back(positions.size());
+
+    size_t payloadBegin = out.size();
+    out.resize(payloadBegin + packedBytes(n, b), 0);
+    uint8_t *payload = &out[payloadBegin];
+
+    if (n == PFOR_VERTICAL_SIZE) {
+        // Value i goes to lane i % 4, slot i / 4 of that lane's bit stream
+        size_t laneWords = packedBytes(n, b) / (4 * PFOR_LANES);
+        vector<uint32_t> words(laneWords * PFOR_LANES, 0);
+        for (size_t i = 0; i < n && b > 0; i++) {
+            uint32_t low = in[i] & lowMask;
+            size_t lane = i % PFOR_LANES;
+            size_t offset = (i / PFOR_LANES) * b;
+            size_t w = offset / 32, s = offset % 32;
+            words[w * PFOR_LANES + lane] |= low << s;
+            if (s + b > 32) {
+                words[(w + 1) * PFOR_LANES + lane] |= low >> (32 - s);
+            }
+        }
+        memcpy(payload, words.data(), words.size() * sizeof(uint32_t));
+    }
+    else {
+        // Horizontal little-endian bit stream
+        for (size_t i = 0; i < n && b > 0; i++) {
+            uint64_t low = in[i] & lowMask;
+            size_t bitPos = i * b;
+            for (size_t written = 0; written < b; ) {
+                size_t byte = (bitPos + written) / 8, shift = (bitPos + written) % 8;
+                payload[byte] |= (uint8_t)((low >> written) << shift);
+                written += 8 - shift;
+            }
+        }
+    }
+
+    out.insert(out.end(), positions.begin(), positions.end());
+    for (uint32_t high : highParts) {
+        while (high > 0x7F) {
+            out.push_back((high & 0x7F) | 0x80);
+            high >>= 7;
+        }
+        out.push_back(high);
+    }
+    return out.size() - begin;
+}
+
+
+#if defined(__SSE2__)
+
+// Unpacks slot K (values 4K..4K+3) of all 4 lanes; offsets are compile-time constants, so no branches remain
+template<uint32_t B, size_t K>
+static inline void unpackSlot(const uint8_t *words, uint32_t *out) {
+    constexpr size_t offset = K * B;
+    constexpr size_t w = offset / 32;
+    constexpr int s = offset % 32;
+    __m128i value = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(words) + w), s);
+    if constexpr (s + B > 32) {
+        __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(words) + w + 1);
+        value = _mm_or_si128(value, _mm_slli_epi32(next, 32 - s));
+    }
+    if constexpr (B < 32) {
+        value = _mm_and_si128(value, _mm_set1_epi32((1u << B) - 1));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + K * PFOR_LANES), value);
+}
+
+template<uint32_t B, size_t... K>
+static void unpackVertical(const uint8_t *words, uint32_t *out, index_sequence<K...>) {
+    if constexpr (B == 0) {
+        memset(out, 0, PFOR_VERTICAL_SIZE * sizeof(uint32_t));
+    }
+    else {
+        (unpackSlot<B, K>(words, out), ...);
+    }
+}
+
+#else
+
+template<uint32_t B, size_t... K>
+static void unpackVertical(const uint8_t *words, uint32_t *out, index_sequence<K...>) {
+    const uint32_t *lanes = reinterpret_cast<const uint32_t *>(words);
+    for (size_t i = 0; i < PFOR_VERTICAL_SIZE; i++) {
+        uint64_t value = 0;
+        if (B > 0) {
+            size_t lane = i % PFOR_LANES;
+            size_t offset = (i / PFOR_LANES) * B;
+            size_t w = offset / 32, s = offset % 32;
+            value = lanes[w * PFOR_LANES + lane] >> s;
+            if (s + B > 32) {
+                value |= (uint64_t)lanes[(w + 1) * PFOR_LANES + lane] << (32 - s);
+            }
+        }
+        out[i] = (uint32_t)(value & ((1ULL << B) - 1));
+    }
+}
+
+#endif
+
+
+template<uint32_t B>
+static void unpackFull(const uint8_t *words, uint32_t *out) {
+    unpackVertical<B>(words, out, make_index_sequence<PFOR_VERTICAL_SIZE / PFOR_LANES>());
+}
+
+template<size_t... B>
+static constexpr auto makeUnpackers(index_sequence<B...>) {
+    return array<void (*)(const uint8_t *, uint32_t *), sizeof...(B)>{&unpackFull<B>...};
+}
+
+// One specialized unpacker per bit width 0..32
+static const auto fullUnpackers = makeUnpackers(make_index_sequence<33>());
+
+
+size_t pforDecode(const uint8_t *in, size_t length, uint32_t *out) {
+    if (length < PFOR_HEADER_SIZE) {
+        return 0;
+    }
+    size_t n = in[0];
+    uint32_t b = in[1];
+    size_t exceptionNum = in[2];
+    const uint8_t *payload = in + PFOR_HEADER_SIZE;
+
+    if (n == PFOR_VERTICAL_SIZE) {
+        fullUnpackers[b](payload, out);
+    }
+    else {
+        uint64_t lowMask = (1ULL << b) - 1;
+        for (size_t i = 0; i < n; i++) {
+            size_t bitPos = i * b;
+            uint64_t bits = 0;
+            size_t firstByte = bitPos / 8, lastByte = (bitPos + b + 7) / 8;
+            for (size_t byte = firstByte; byte < lastByte; byte++) {
+                bits |= (uint64_t)payload[byte] << (8 * (byte - firstByte));
+            }
+            out[i] = (uint32_t)((bits >> (bitPos % 8)) & lowMask);
+        }
+    }
+
+    // Patch the exceptions with their high bits
+    const uint8_t *positions = payload + packedBytes(n, b);
+    const uint8_t *high = positions + exceptionNum;
+    for (size_t e = 0; e < exceptionNum; e++) {
+        uint32_t value = 0;
+        int shift = 0;
+        while (*high & 0x80) {
+            value |= (uint32_t)(*high++ & 0x7F) << shift;
+            shift += 7;
+        }
+        value |= (uint32_t)(*high++) << shift;
+        out[positions[e]] |= value << b;
+    }
+    return n;
+}
@@ -0,0 +1,22 @@
+#ifndef SEARCHSYSTEM_PFORDELTA_H
+#define SEARCHSYSTEM_PFORDELTA_H
+
+#include "config.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+using namespace std;
+
+
+// Bit-packed chunk codec with PFor-style exceptions, for chunks of at most POSTINGS_PER_CHUNK values.
+//
+// Chunk layout: [value count][bit width b][exception count e][packed low bits][e positions][e varbyte high parts]
+// A full 64-value chunk is packed vertically in 4 lanes of 32-bit words (value i goes to lane i % 4),
+// so every 4 consecutive values are unpacked by the same shifts and masks with one SIMD operation.
+// Shorter chunks (the tail of a list) are packed horizontally into ceil(n * b / 8) bytes.
+
+size_t pforEncode(const uint32_t *in, size_t n, vector<uint8_t> &out);  // appends to out, returns bytes written
+size_t pforDecode(const uint8_t *in, size_t length, uint32_t *out);  // returns the number of values, out holds 64
+size_t pforChunkBytes(const uint32_t *in, size_t n);  // encoded size without encoding
+
+#endif //SEARCHSYSTEM_PFORDELTA_H
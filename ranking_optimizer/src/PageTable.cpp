@@ -2,15 +2,64 @@
 // Created by Dong Li on 10/15/24.
 //
 #include "PageTable.h"
+#include <cmath>
 using namespace std;
 
 
 void PageTable::_getAvgWordCount() {
     double allCount = 0;
-    for (const auto& doc : pageTable) {
-        allCount += doc.wordCount;
+    for (uint32_t i = 0; i < totalDoc; i++) {
+        allCount += wordCountList[i];
+    }
+    avgWordCount = totalDoc ? allCount / totalDoc : 0;
+}
+
+
+// Lucene's SmallFloat.intToByte4: lengths below 24 are exact, longer ones keep 4 significant bits.
+// The decoded length never exceeds the real one, so a byte norm never lowers a score.
+static const uint32_t NORM_EXACT_BYTES = 24;
+
+static uint8_t lengthToByte(uint32_t length) {
+    if (length < NORM_EXACT_BYTES) {
+        return length;
+    }
+    uint32_t i = min<uint32_t>(length - NORM_EXACT_BYTES, INT32_MAX);
+    uint32_t bits = 32 - __builtin_clz(i | 1);
+    if (bits < 4) {
+        return NORM_EXACT_BYTES + i;
+    }
+    uint32_t shift = bits - 4;
+    return NORM_EXACT_BYTES + (((i >> shift) & 0x07) | ((shift + 1) << 3));
+}
+
+static uint32_t byteToLength(uint8_t b) {
+    if (b < NORM_EXACT_BYTES) {
+        return b;
+    }
+    uint32_t i = b - NORM_EXACT_BYTES;
+    int shift = (int)(i >> 3) - 1;
+    return NORM_EXACT_BYTES + (shift < 0 ? (i & 0x07) : (((i & 0x07) | 0x08) << shift));
+}
+
+
+// One norm per internal docID, so scoring is a lookup: docIDs without a document (the subset) get length 0
+void PageTable::_buildNorms() {
+    uint32_t docIdNum = totalDoc ? docIdList[totalDoc - 1] + 1 : 0;
+    double average = avgWordCount > 0 ? avgWordCount : 1;
+    if (BM25_NORM_BYTES) {
+        for (uint32_t b = 0; b < 256; b++) {
+            _normDecode[b] = bm25K1 * ((1 - bm25B) + bm25B * byteToLength(b) / average);
+        }
+        _normByteList.assign(docIdNum, 0);
+        for (uint32_t i = 0; i < totalDoc; i++) {
+            _normByteList[docIdList[i]] = lengthToByte(wordCountList[i]);
+        }
+        return;
+    }
+    _normList.assign(docIdNum, bm25K1 * (1 - bm25B));
+    for (uint32_t i = 0; i < totalDoc; i++) {
+        _normList[docIdList[i]] = bm25K1 * ((1 - bm25B) + bm25B * wordCountList[i] / average);
     }
-    avgWordCount = allCount/pageTable.size();
 }
 
 
@@ -22,16 +71,43 @@ void Document::print() const {
 
 PageTable::PageTable(/* args */) {
     totalDoc = 0;
-    pageTable.empty();
 }
 
 
 PageTable::~PageTable() {
+    _unmap();
+}
+
+
+void PageTable::_unmap() {
+    unmapFile(_mapped, _mappedSize);
+    _mapped = nullptr;
+    _mappedSize = 0;
+    _externalIdOffsetList = nullptr;
+    _externalIdBytes = nullptr;
 }
 
 
 void PageTable::add(Document docIdItem) {
-    pageTable.push_back(docIdItem);
+    _docIdList.push_back(docIdItem.docId);
+    _wordCountList.push_back(docIdItem.wordCount);
+    _dataLengthList.push_back(docIdItem.dataLength);
+    _docPosList.push_back(docIdItem.docPos);
+    docIdList = _docIdList.data();
+    wordCountList = _wordCountList.data();
+    dataLengthList = _dataLengthList.data();
+    docPosList = _docPosList.data();
+    totalDoc = _docIdList.size();
+}
+
+
+Document PageTable::getDocument(uint32_t docIndex) const {
+    Document doc;
+    doc.docId = docIdList[docIndex];
+    doc.dataLength = dataLengthList[docIndex];
+    doc.wordCount = wordCountList[docIndex];
+    doc.docPos = docPosList[docIndex];
+    return doc;
 }
 
 
@@ -46,7 +122,7 @@ void PageTable::write() {
     }
     else {  // FILEMODE == ASCII
         path = string(PAGE_TABLE_PATH).substr(0, string(PAGE_TABLE_PATH).find_last_of('/')) + "/ASCII_" + string(PAGE_TABLE_PATH).substr(string(PAGE_TABLE_PATH).find_last_of('/') + 1);
-        outfile.open(path);
+        outfile.open(path, ofstream::binary);  // the columns are binary in both modes
     }
 
     // Check for errors while opening the file
@@ -56,68 +132,142 @@ void PageTable::write() {
         return;
     }
 
-    for (const auto& doc : pageTable) {
-        outfile << doc.docId << " " << doc.dataLength << " " << doc.wordCount << " "
-        << doc.docPos << " " << endl;
-    }
+    writeHeaderPlaceholder(outfile);
+    header = newFileHeader(FORMAT_MAGIC_PAGE_TABLE);
+    auto writeColumn = [&](uint32_t id, const void *data, size_t size) {
+        alignSection(outfile);
+        beginSection(header, id, outfile.tellp());
+        outfile.write(static_cast<const char *>(data), size);
+        endSection(header, outfile.tellp());
+    };
+    writeColumn(SECTION_DOCUMENTS, _docIdList.data(), totalDoc * sizeof(uint32_t));
+    writeColumn(SECTION_DOC_LENGTHS, _wordCountList.data(), totalDoc * sizeof(uint32_t));
+    writeColumn(SECTION_DOC_DATA_LENGTHS, _dataLengthList.data(), totalDoc * sizeof(uint32_t));
+    writeColumn(SECTION_DOC_POSITIONS, _docPosList.data(), totalDoc * sizeof(uint64_t));
 
+    // External IDs: offsets, then the concatenated strings
+    if (!externalIdList.empty()) {
+        vector<uint64_t> offsetList(totalDoc + 1, 0);
+        string bytes;
+        for (uint32_t docId = 0; docId < totalDoc; docId++) {
+            if (docId < externalIdList.size()) {
+                bytes += externalIdList[docId];
+            }
+            offsetList[docId + 1] = bytes.size();
+        }
+        alignSection(outfile);
+        beginSection(header, SECTION_EXTERNAL_IDS, outfile.tellp());
+        outfile.write(reinterpret_cast<const char *>(offsetList.data()), offsetList.size() * sizeof(uint64_t));
+        outfile.write(bytes.data(), bytes.size());
+        endSection(header, outfile.tellp());
+    }
     outfile.close();
+
+    _getAvgWordCount();
+    header.docNum = totalDoc;
+    header.avgDocLength = avgWordCount;
+    finalizeFile(path, header);
 }
 
 
 void PageTable::print() {
-    for (const auto& doc : pageTable) {
-        doc.print();
+    for (uint32_t i = 0; i < totalDoc; i++) {
+        getDocument(i).print();
     }
 }
 
 
-void PageTable::load() {
-
-    ifstream infile;
+void PageTable::load(double k1, double b) {
     string path;
     if (FILE_MODE_BIN) {  // FILEMODE == BIN
         path = string(PAGE_TABLE_PATH).substr(0, string(PAGE_TABLE_PATH).find_last_of('/')) + "/BIN_" + string(PAGE_TABLE_PATH).substr(string(PAGE_TABLE_PATH).find_last_of('/') + 1);
-        infile.open(path, ofstream::binary);
     }
     else {  // FILEMODE == ASCII
         path = string(PAGE_TABLE_PATH).substr(0, string(PAGE_TABLE_PATH).find_last_of('/')) + "/ASCII_" + string(PAGE_TABLE_PATH).substr(string(PAGE_TABLE_PATH).find_last_of('/') + 1);
-        infile.open(path);
     }
     if (DEBUG_MODE) {
         cout << "page table file path: " << path << endl;
     }
-    if(!infile){
-        cout << "can not read " << path << endl;
-        exit(0);
+    if (!readHeader(path, FORMAT_MAGIC_PAGE_TABLE, header)) {
+        exit(1);
+    }
+    _unmap();
+    _mapped = mapFile(path, _mappedSize);
+    if (!_mapped) {
+        exit(1);
     }
-    pageTable.clear();
+    _docIdList.clear();
+    _wordCountList.clear();
+    _dataLengthList.clear();
+    _docPosList.clear();
+    externalIdList.clear();
+
+    // Every column must hold exactly header.docNum entries
+    auto column = [&](uint32_t id, size_t entrySize) -> const void * {
+        const FileSection *section = findSection(header, id);
+        if (!section || section->size != header.docNum * entrySize || section->offset % 8 != 0) {
+            cerr << path << ": missing or malformed section " << id << ", rebuild the page table" << endl;
+            exit(1);
+        }
+        return _mapped + section->offset;
+    };
+    totalDoc = header.docNum;
+    docIdList = static_cast<const uint32_t *>(column(SECTION_DOCUMENTS, sizeof(uint32_t)));
+    wordCountList = static_cast<const uint32_t *>(column(SECTION_DOC_LENGTHS, sizeof(uint32_t)));
+    dataLengthList = static_cast<const uint32_t *>(column(SECTION_DOC_DATA_LENGTHS, sizeof(uint32_t)));
+    docPosList = static_cast<const uint64_t *>(column(SECTION_DOC_POSITIONS, sizeof(uint64_t)));
 
-    while(!infile.eof()) {
-        Document newDoc;
-        infile >> newDoc.docId >> newDoc.dataLength >> newDoc.wordCount >> newDoc.docPos;
-        pageTable.push_back(newDoc);
+    const FileSection *externalIds = findSection(header, SECTION_EXTERNAL_IDS);
+    if (externalIds) {
+        uint64_t offsetBytes = (header.docNum + 1) * sizeof(uint64_t);
+        _externalIdOffsetList = reinterpret_cast<const uint64_t *>(_mapped + externalIds->offset);
+        _externalIdBytes = reinterpret_cast<const char *>(_mapped + externalIds->offset + offsetBytes);
+        if (externalIds->size < offsetBytes || _externalIdOffsetList[header.docNum] != externalIds->size - offsetBytes) {
+            cerr << path << ": malformed external IDs, rebuild the page table" << endl;
+            exit(1);
+        }
     }
-    totalDoc = pageTable.size();
     if (DEBUG_MODE) {
         cout<< "totalDoc of pageTable: " << totalDoc << endl;
     }
     _getAvgWordCount();
+    bm25K1 = k1;
+    bm25B = b;
+    _buildNorms();
+}
+
+
+// Impacts and chunk upper bounds hold for the BM25 parameters they were computed with only. Impacts cannot be
+// rescored, so an impact index must match; frequencies are rescored, only the bounds are lost and false is returned
+bool PageTable::checkScoring(const FileHeader &indexHeader, const string &indexPath) const {
+    bool normBytes = (indexHeader.flags & FORMAT_FLAG_NORM_BYTES) != 0;
+    if (indexHeader.bm25K1 == bm25K1 && indexHeader.bm25B == bm25B && normBytes == (BM25_NORM_BYTES != 0)) {
+        return true;
+    }
+    if (IMPACT_MODE) {
+        cerr << indexPath << " stores impacts of k1 " << indexHeader.bm25K1 << " and b " << indexHeader.bm25B
+             << (normBytes ? " with one-byte" : " with exact") << " document lengths, rebuild it for these parameters" << endl;
+        exit(1);
+    }
+    cout << indexPath << " was scored with k1 " << indexHeader.bm25K1 << " and b " << indexHeader.bm25B
+         << (normBytes ? " with one-byte" : " with exact") << " document lengths: its score bounds do not hold,"
+         << " disjunctive queries score every document" << endl;
+    return false;
 }
 
 
 // Binary search function to find the index of the given docId
 int PageTable::findDocIndex(uint32_t docId) const {
     int left = 0;
-    int right = pageTable.size() - 1;
+    int right = totalDoc - 1;
 
     while (left <= right) {
         int mid = left + (right - left) / 2;
 
-        if (pageTable[mid].docId == docId) {
+        if (docIdList[mid] == docId) {
             return mid;  // Found the docId, return the index
         }
-        else if (pageTable[mid].docId < docId) {
+        else if (docIdList[mid] < docId) {
             left = mid + 1;  // Search the right half
         }
         else {
@@ -126,4 +276,45 @@ int PageTable::findDocIndex(uint32_t docId) const {
     }
 
     return -1;  // docId not found
-}
\ No newline at end of file
+}
+
+
+string PageTable::getExternalId(uint32_t docId) const {
+    if (docId < externalIdList.size()) {
+        return externalIdList[docId];
+    }
+    if (_externalIdOffsetList && docId < totalDoc) {
+        uint64_t begin = _externalIdOffsetList[docId];
+        return string(_externalIdBytes + begin, _externalIdOffsetList[docId + 1] - begin);
+    }
+    return to_string(docId);
+}
+
+
+// Calculates the BM25 contribution of a term with termDocNum postings to a document
+double PageTable::getBM25(uint32_t docId, uint32_t termDocNum, uint32_t freq) const {
+    double K = BM25_NORM_BYTES ? _normDecode[_normByteList[docId]] : _normList[docId];  // BM25 scaling factor
+    double N = totalDoc;
+    double f_t = termDocNum;
+    return log((N - f_t + 0.5) / (f_t + 0.5)) * (bm25K1 + 1) * freq / (K + freq);
+}
+
+
+// Impacts are quantized against the largest possible contribution: a term in one document, tf -> infinity
+double PageTable::getImpactScale() const {
+    double maxScore = log((totalDoc - 1 + 0.5) / 1.5) * (bm25K1 + 1);
+    return maxScore / IMPACT_LEVELS;
+}
+
+
+// Negative contributions (terms in more than half of the documents) are clamped to 0
+uint32_t PageTable::quantizeImpact(double score) const {
+    double level = round(score / getImpactScale());
+    return (uint32_t)max(0.0, min(level, (double)IMPACT_LEVELS));
+}
+
+
+uint32_t PageTable::quantizeImpactUp(double score) const {
+    double level = ceil(score / getImpactScale());
+    return (uint32_t)max(0.0, min(level, (double)IMPACT_LEVELS));
+}
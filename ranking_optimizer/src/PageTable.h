@@ -6,6 +6,7 @@
 #define SEARCHSYSTEM_PAGETABLE_H
 
 #include "config.h"
+#include "IndexFormat.h"
 using namespace std;
 
 class Document {
@@ -19,23 +20,51 @@ public:
 
 
 // assign document IDs (doc IDs) to pages
+// The documents are stored as columns, one array per field, so scoring only touches the dense word counts.
+// add() fills owned arrays during parsing; load() maps the page table file and reads the arrays in place.
 class PageTable {
 private:
     /* data */
+    vector<uint32_t> _docIdList, _wordCountList, _dataLengthList;
+    vector<uint64_t> _docPosList;
+    const uint64_t *_externalIdOffsetList = nullptr;  // docNum + 1 offsets into _externalIdBytes, when loaded
+    const char *_externalIdBytes = nullptr;
+    const uint8_t *_mapped = nullptr;  // the page table file, mapped read-only by load()
+    size_t _mappedSize = 0;
+    vector<float> _normList;  // BM25 length normalization k1 * ((1 - b) + b * length / average) by internal docID
+    vector<uint8_t> _normByteList;  // with BM25_NORM_BYTES: the length of every docID in one byte instead
+    float _normDecode[256] = {};  // normalization of every byte length
     void _getAvgWordCount();
+    void _buildNorms();
+    void _unmap();
 
 public:
     uint32_t totalDoc;
-    vector<Document> pageTable;
-    uint32_t avgWordCount;
+    const uint32_t *docIdList = nullptr;  // column of every field, indexed by document index
+    const uint32_t *wordCountList = nullptr;
+    const uint32_t *dataLengthList = nullptr;
+    const uint64_t *docPosList = nullptr;
+    vector<string> externalIdList;  // external document IDs indexed by internal docID while parsing (BEIR corpora only)
+    double avgWordCount;
+    double bm25K1 = BM25_K1, bm25B = BM25_B;  // set by load(), the norms and every score below use them
+    FileHeader header;  // format header of the page table file, written by write() or read by load()
 
     PageTable(/* args */);
     ~PageTable();
+    PageTable(const PageTable &) = delete;  // owns the mapping of the page table file
+    PageTable &operator=(const PageTable &) = delete;
     void add(Document docIDitem);
+    Document getDocument(uint32_t docIndex) const;
     void write();
     void print();
-    void load();
+    void load(double k1 = BM25_K1, double b = BM25_B);
+    bool checkScoring(const FileHeader &indexHeader, const string &indexPath) const;  // whether the index's score bounds hold
     int findDocIndex(uint32_t docId) const;
+    double getBM25(uint32_t docId, uint32_t termDocNum, uint32_t freq) const;  // term-document BM25 contribution
+    double getImpactScale() const;  // BM25 score of one impact level
+    uint32_t quantizeImpact(double score) const;
+    uint32_t quantizeImpactUp(double score) const;  // smallest level not below score, for upper bounds
+    string getExternalId(uint32_t docId) const;  // falls back to the numeric docID
 };
 
 
@@ -0,0 +1,255 @@
+#include "PostingCodec.h"
+#include <cstring>
+using namespace std;
+
+
+// Decoding cost in ns per docID: the median of 3 runs of the CODEC_DECODE_NS line that Benchmark::compareCodecs
+// prints (BENCHMARK_FLAG 1), over the 400k-passage collection on one core of a Xeon VM, with runs about 30% apart.
+// Re-run it to calibrate another machine.
+static const double CODEC_DECODE_NS[CODEC_NUM] = {
+        0.7,  // CODEC_VARBYTE
+        0.4,  // CODEC_PFOR
+        3.6,  // CODEC_EF
+        0.2,  // CODEC_RAW
+        3.7,  // CODEC_BITMAP
+};
+
+
+static inline void appendVarbyte(uint32_t value, vector<uint8_t> &out) {
+    while (value > 0x7F) {
+        out.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(value);
+}
+
+
+static inline size_t readVarbyte(const uint8_t *in, size_t length, uint32_t &value) {
+    size_t pos = 0;
+    value = 0;
+    for (int shift = 0; pos < length; shift += 7) {
+        uint8_t byte = in[pos++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    return pos;
+}
+
+
+// Raw: n little-endian 32-bit integers
+static size_t rawEncode(const uint32_t *values, size_t n, vector<uint8_t> &out) {
+    size_t begin = out.size();
+    out.resize(begin + n * sizeof(uint32_t));
+    memcpy(&out[begin], values, n * sizeof(uint32_t));
+    return n * sizeof(uint32_t);
+}
+
+
+static size_t rawDecode(const uint8_t *in, size_t length, uint32_t *out) {
+    memcpy(out, in, length);
+    return length / sizeof(uint32_t);
+}
+
+
+// Bitmap: [value count][first docID, varbyte][one bit per docID from the first to the last one]
+static size_t bitmapEncode(const uint32_t *gaps, size_t n, vector<uint8_t> &out) {
+    size_t begin = out.size();
+    uint32_t base = gaps[0];
+    uint32_t span = 0;
+    for (size_t i = 1; i < n; i++) {
+        span += gaps[i];
+    }
+    out.push_back(n);
+    appendVarbyte(base, out);
+    size_t bitmapBegin = out.size();
+    out.resize(bitmapBegin + span / 8 + 1, 0);
+    uint32_t offset = 0;
+    for (size_t i = 0; i < n; i++) {
+        offset += (i ? gaps[i] : 0);
+        out[bitmapBegin + offset / 8] |= 1 << (offset % 8);
+    }
+    return out.size() - begin;
+}
+
+
+static size_t bitmapDecode(const uint8_t *in, size_t length, uint32_t *out) {
+    if (length < 2) {
+        return 0;
+    }
+    size_t n = in[0];
+    uint32_t base;
+    size_t pos = 1 + readVarbyte(in + 1, length - 1, base);
+
+    size_t count = 0;
+    uint32_t prev = 0;
+    for (size_t byte = pos; byte < length && count < n; byte++) {
+        uint32_t bits = in[byte];
+        while (bits && count < n) {
+            uint32_t docId = base + (uint32_t)(byte - pos) * 8 + __builtin_ctz(bits);
+            out[count++] = docId - prev;
+            prev = docId;
+            bits &= bits - 1;
+        }
+    }
+    return count;
+}
+
+
+// Frequencies: nothing at all when every value is 1 (the decoder is never called for such a chunk),
+// otherwise [value count][2-bit codes, 4 per byte][varbyte escapes]; codes 1-3 are the frequency itself,
+// code 0 means the frequency is the next escape
+static size_t freqEncode(const uint32_t *values, size_t n, vector<uint8_t> &out) {
+    bool allOnes = true;
+    for (size_t i = 0; i < n && allOnes; i++) {
+        allOnes = (values[i] == 1);
+    }
+    if (allOnes) {
+        return 0;
+    }
+
+    size_t begin = out.size();
+    out.push_back(n);
+    size_t codeBegin = out.size();
+    out.resize(codeBegin + (n + 3) / 4, 0);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t code = (values[i] <= 3) ? values[i] : 0;
+        out[codeBegin + i / 4] |= code << (2 * (i % 4));
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (values[i] > 3 || values[i] == 0) {
+            appendVarbyte(values[i], out);
+        }
+    }
+    return out.size() - begin;
+}
+
+
+static size_t freqDecode(const uint8_t *in, size_t length, uint32_t *out) {
+    if (length == 0) {
+        return 0;
+    }
+    size_t n = in[0];
+    const uint8_t *codes = in + 1;
+    const uint8_t *escape = codes + (n + 3) / 4;
+    const uint8_t *end = in + length;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t code = (codes[i / 4] >> (2 * (i % 4))) & 3;
+        if (code) {
+            out[i] = code;
+        }
+        else {
+            escape += readVarbyte(escape, end - escape, out[i]);
+        }
+    }
+    return n;
+}
+
+
+static size_t varbyteChunkEncode(const uint32_t *values, size_t n, vector<uint8_t> &out) {
+    size_t begin = out.size();
+    for (size_t i = 0; i < n; i++) {
+        appendVarbyte(values[i], out);
+    }
+    return out.size() - begin;
+}
+
+
+uint32_t freqCodec(uint32_t codec) {
+    if (codec == CODEC_RAW) {
+        return CODEC_RAW;
+    }
+    return IMPACT_MODE ? CODEC_PFOR : CODEC_FREQ;  // impacts are spread over 8 bits, frequencies are mostly 1
+}
+
+
+uint32_t chunkCodec(uint32_t codec, bool isDocIdChunk) {
+    return isDocIdChunk ? codec : freqCodec(codec);
+}
+
+
+bool codecCanSkip(uint32_t codec) {
+    return codec == CODEC_EF;
+}
+
+
+const char *codecName(uint32_t codec) {
+    switch (codec) {
+        case CODEC_VARBYTE: return "varbyte";
+        case CODEC_PFOR: return "PFor";
+        case CODEC_EF: return "Elias-Fano";
+        case CODEC_RAW: return "raw";
+        case CODEC_BITMAP: return "bitmap";
+        case CODEC_FREQ: return "freq";
+        default: return "unknown";
+    }
+}
+
+
+size_t encodeChunk(uint32_t codec, const uint32_t *values, size_t n, vector<uint8_t> &out) {
+    switch (codec) {
+        case CODEC_PFOR: return pforEncode(values, n, out);
+        case CODEC_EF: return efEncode(values, n, out);
+        case CODEC_RAW: return rawEncode(values, n, out);
+        case CODEC_BITMAP: return bitmapEncode(values, n, out);
+        case CODEC_FREQ: return freqEncode(values, n, out);
+        default: return varbyteChunkEncode(values, n, out);
+    }
+}
+
+
+size_t decodeChunk(uint32_t codec, const uint8_t *in, size_t length, uint32_t *out) {
+    switch (codec) {
+        case CODEC_PFOR: return pforDecode(in, length, out);
+        case CODEC_EF: return efDecode(in, length, out);
+        case CODEC_RAW: return rawDecode(in, length, out);
+        case CODEC_BITMAP: return bitmapDecode(in, length, out);
+        case CODEC_FREQ: return freqDecode(in, length, out);
+        default: return varbyteDecodeSIMD(in, length, out);
+    }
+}
+
+
+void CodecChooser::add(const uint32_t *docIdGaps, const uint32_t *freqs, size_t n) {
+    uint64_t span = 0;
+    for (size_t i = 1; i < n; i++) {
+        span += docIdGaps[i];
+    }
+    _bitmapFits = _bitmapFits && span / 8 <= n * sizeof(uint32_t);  // not larger than the raw chunk
+    _postingNum += n;
+
+    for (uint32_t codec = 0; codec < CODEC_NUM; codec++) {
+        if (codec == CODEC_BITMAP && !_bitmapFits) {
+            continue;
+        }
+        _encoded.clear();
+        _byteList[codec] += encodeChunk(codec, docIdGaps, n, _encoded);
+        _encoded.clear();
+        _byteList[codec] += encodeChunk(freqCodec(codec), freqs, n, _encoded);
+    }
+}
+
+
+uint32_t CodecChooser::choose() const {
+    if (POSTING_CODEC != CODEC_AUTO) {
+        return POSTING_CODEC;
+    }
+    if (_postingNum == 0) {
+        return CODEC_VARBYTE;
+    }
+
+    uint32_t bestCodec = CODEC_VARBYTE;
+    double bestCost = 0;
+    for (uint32_t codec = 0; codec < CODEC_NUM; codec++) {
+        if (codec == CODEC_BITMAP && !_bitmapFits) {
+            continue;
+        }
+        double cost = 8.0 * _byteList[codec] / _postingNum + CODEC_SPEED_WEIGHT * CODEC_DECODE_NS[codec];
+        if (codec == 0 || cost < bestCost) {
+            bestCost = cost;
+            bestCodec = codec;
+        }
+    }
+    return bestCodec;
+}
@@ -0,0 +1,44 @@
+#ifndef SEARCHSYSTEM_POSTINGCODEC_H
+#define SEARCHSYSTEM_POSTINGCODEC_H
+
+#include "config.h"
+#include "Varbyte.h"
+#include "PForDelta.h"
+#include "EliasFano.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+using namespace std;
+
+
+// Chunk codecs of the index. Every list records one codec ID (CODEC_* in config.h) in its LexiconItem;
+// the docID chunks use that codec and the frequency chunks use freqCodec(codec), which is CODEC_FREQ
+// except for raw lists (and PFor for the impacts of IMPACT_MODE). A CODEC_FREQ chunk is empty when all its frequencies are 1, so scoring loops
+// should check the chunk size and skip decoding. Dispatch is a switch on the ID, no virtual calls.
+//
+// docID chunks are passed as gaps with the first value absolute, as _writeBlocks produces them.
+// decodeChunk needs room for max(length, POSTINGS_PER_CHUNK) integers in `out`.
+
+uint32_t freqCodec(uint32_t codec);
+uint32_t chunkCodec(uint32_t codec, bool isDocIdChunk);  // codec of one docID or frequency chunk of a list
+bool codecCanSkip(uint32_t codec);  // nextGEQ runs on the compressed docID chunks
+const char *codecName(uint32_t codec);
+
+size_t encodeChunk(uint32_t codec, const uint32_t *values, size_t n, vector<uint8_t> &out);  // appends to out
+size_t decodeChunk(uint32_t codec, const uint8_t *in, size_t length, uint32_t *out);  // returns the number of values
+
+// Picks the codec of one list: smallest bits per posting plus CODEC_SPEED_WEIGHT times the decoding cost.
+// Chunks are added one at a time, so the list never has to be held in memory.
+class CodecChooser {
+private:
+    uint64_t _byteList[CODEC_NUM]{};  // encoded size of the chunks so far, per codec
+    uint64_t _postingNum = 0;
+    bool _bitmapFits = true;  // bitmaps only pay off for dense chunks; sparse ones would not even fit in a block
+    vector<uint8_t> _encoded;  // scratch buffer
+
+public:
+    void add(const uint32_t *docIdGaps, const uint32_t *freqs, size_t n);
+    uint32_t choose() const;  // POSTING_CODEC unless it is CODEC_AUTO
+};
+
+#endif //SEARCHSYSTEM_POSTINGCODEC_H
@@ -0,0 +1,144 @@
+#include "PostingCursor.h"
+#include "PostingCodec.h"
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+
+PostingCursor::PostingCursor(const uint8_t *data, uint64_t listBegin, const SkipDirectory &skips, uint32_t codec,
+                             uint32_t docNum, const PageTable *pageTable)
+        : _data(data), _listBegin(listBegin), _skips(skips), _codec(codec), _docNum(docNum), _pageTable(pageTable),
+          _compressed(codecCanSkip(codec)) {
+    if (!_data || _skips.chunkNum == 0) {
+        _docId = MAX_DOC_ID;
+        return;
+    }
+    _openChunk(0);
+    _docId = _chunkDocId(0);
+}
+
+
+// Chunk offsets and sizes of one block, from its metadata
+void PostingCursor::_readBlock(uint32_t blockIdx) {
+    const SkipEntry &entry = _skips.blockList[blockIdx];
+    uint32_t offset = entry.offset - _listBegin;
+    uint32_t metadataSize;
+    memcpy(&metadataSize, _data + offset, sizeof(uint32_t));
+    const uint8_t *meta = _data + offset + sizeof(uint32_t);
+    uint32_t dataPos = offset + 4 + 12 * metadataSize;
+
+    _docIdOffsetList.resize(metadataSize);
+    _docIdSizeList.resize(metadataSize);
+    _freqOffsetList.resize(metadataSize);
+    _freqSizeList.resize(metadataSize);
+    for (uint32_t i = 0; i < metadataSize; i++) {
+        memcpy(&_docIdSizeList[i], meta + 4 * (metadataSize + i), sizeof(uint32_t));
+        memcpy(&_freqSizeList[i], meta + 4 * (2 * metadataSize + i), sizeof(uint32_t));
+        _docIdOffsetList[i] = dataPos;
+        _freqOffsetList[i] = dataPos + _docIdSizeList[i];
+        dataPos += _docIdSizeList[i] + _freqSizeList[i];
+    }
+    _blockIdx = blockIdx;
+    _blockChunkBegin = entry.chunkPos - _skips.blockList[0].chunkPos;
+}
+
+
+void PostingCursor::_openChunk(uint32_t chunkIdx) {
+    uint32_t blockIdx = _skips.blockOfChunk(chunkIdx);
+    if (blockIdx != _blockIdx) {
+        _readBlock(blockIdx);
+    }
+    _chunkIdx = chunkIdx;
+    _pos = 0;
+    _freqDecoded = false;
+    uint32_t i = chunkIdx - _blockChunkBegin;
+    if (_compressed) {
+        _efChunk.open(_data + _docIdOffsetList[i], _docIdSizeList[i]);
+        _chunkSize = _efChunk.size();
+        return;
+    }
+    // Gaps, the first one absolute; no chunk holds more than max(size, POSTINGS_PER_CHUNK) integers
+    _docIdList.resize(max<size_t>(_docIdSizeList[i], POSTINGS_PER_CHUNK));
+    _chunkSize = decodeChunk(chunkCodec(_codec, true), _data + _docIdOffsetList[i], _docIdSizeList[i], _docIdList.data());
+    for (uint32_t j = 1; j < _chunkSize; j++) {
+        _docIdList[j] += _docIdList[j - 1];
+    }
+}
+
+
+uint32_t PostingCursor::next() {
+    if (_docId == (uint32_t)MAX_DOC_ID) {
+        return _docId;
+    }
+    _pos += 1;
+    if (_pos == _chunkSize) {
+        if (_chunkIdx + 1 >= _skips.chunkNum) {
+            _docId = MAX_DOC_ID;
+            return _docId;
+        }
+        _openChunk(_chunkIdx + 1);
+    }
+    _docId = _chunkDocId(_pos);
+    return _docId;
+}
+
+
+uint32_t PostingCursor::nextGEQ(uint32_t target) {
+    if (target <= _docId) {
+        return _docId;
+    }
+    if (target > _skips.chunkLastList[_chunkIdx]) {
+        // Skip whole chunks without touching their data
+        uint32_t chunkIdx = _skips.findChunk(target, _chunkIdx + 1);
+        if (chunkIdx >= _skips.chunkNum) {
+            _docId = MAX_DOC_ID;
+            return _docId;
+        }
+        _openChunk(chunkIdx);
+    }
+    // The chunk's last docID is >= target, so the search always lands inside it
+    if (_compressed) {
+        _pos = max(_pos, _efChunk.nextGEQ(target));
+    }
+    else {
+        _pos = lower_bound(_docIdList.begin() + _pos, _docIdList.begin() + _chunkSize, target) - _docIdList.begin();
+    }
+    _docId = _chunkDocId(_pos);
+    return _docId;
+}
+
+
+void PostingCursor::shallowNextGEQ(uint32_t target) {
+    uint32_t from = _chunkIdx;
+    if (_shallowChunk > from && _skips.chunkLastList[_shallowChunk - 1] < target) {
+        from = _shallowChunk;  // targets mostly increase: search on from the last chunk found
+    }
+    if (from < _skips.chunkNum && target <= _skips.chunkLastList[from]) {
+        _shallowChunk = from;
+        return;
+    }
+    _shallowChunk = _skips.findChunk(target, from);
+}
+
+
+uint32_t PostingCursor::freq() {
+    uint32_t i = _chunkIdx - _blockChunkBegin;
+    if (_freqSizeList[i] == 0) {
+        return 1;  // all-ones chunk
+    }
+    if (!_freqDecoded) {
+        _freqList.resize(max<size_t>(_freqSizeList[i], POSTINGS_PER_CHUNK));
+        decodeChunk(chunkCodec(_codec, false), _data + _freqOffsetList[i], _freqSizeList[i], _freqList.data());
+        _freqDecoded = true;
+    }
+    return _freqList[_pos];
+}
+
+
+double PostingCursor::score() {
+    if (IMPACT_MODE) {
+        return freq();
+    }
+    return _pageTable->getBM25(_docId, _docNum, freq());
+}
+
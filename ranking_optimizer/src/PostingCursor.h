@@ -0,0 +1,67 @@
+#ifndef SEARCHSYSTEM_POSTINGCURSOR_H
+#define SEARCHSYSTEM_POSTINGCURSOR_H
+
+#include "config.h"
+#include "EliasFano.h"
+#include "PageTable.h"
+#include "SkipDirectory.h"
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+
+// Forward cursor over the postings of one term, the only way query processing reads a list.
+// One POSTINGS_PER_CHUNK chunk is decoded at a time, and only when the cursor enters it: nextGEQ finds the
+// chunk of its target with the last docID of every chunk in the skip directory, so the chunks it passes
+// over are never decoded, and Elias-Fano chunks are searched without being decoded at all.
+// Frequencies of a chunk are decoded the first time one of them is asked for.
+class PostingCursor {
+private:
+    const uint8_t *_data = nullptr;  // first byte of the term's postings
+    uint64_t _listBegin = 0;  // index file offset of _data
+    SkipDirectory _skips;
+    uint32_t _codec = CODEC_VARBYTE;
+    uint32_t _docNum = 0;  // documents of the term, for BM25
+    const PageTable *_pageTable = nullptr;
+
+    uint32_t _blockIdx = UINT32_MAX;  // block whose chunk offsets are loaded below
+    uint32_t _blockChunkBegin = 0;  // index of the block's first chunk in the term
+    vector<uint32_t> _docIdOffsetList, _docIdSizeList, _freqOffsetList, _freqSizeList;
+
+    uint32_t _chunkIdx = 0;
+    uint32_t _shallowChunk = 0;  // chunk found by the last shallowNextGEQ
+    uint32_t _chunkSize = 0;  // postings in the current chunk
+    uint32_t _pos = 0;  // index inside the current chunk
+    uint32_t _docId = MAX_DOC_ID;
+    vector<uint32_t> _docIdList;  // docIDs of the current chunk, unless it is searched compressed
+    EliasFanoChunk _efChunk;  // the current chunk of a CODEC_EF list
+    bool _compressed = false;  // codecCanSkip: search _efChunk instead of decoding the chunk
+    vector<uint32_t> _freqList;
+    bool _freqDecoded = false;
+
+    void _readBlock(uint32_t blockIdx);
+    void _openChunk(uint32_t chunkIdx);
+    uint32_t _chunkDocId(uint32_t pos) const { return _compressed ? _efChunk.access(pos) : _docIdList[pos]; }
+
+public:
+    PostingCursor() = default;  // empty list, for terms not in the index
+    PostingCursor(const uint8_t *data, uint64_t listBegin, const SkipDirectory &skips, uint32_t codec,
+                  uint32_t docNum, const PageTable *pageTable);
+
+    uint32_t docId() const { return _docId; }  // MAX_DOC_ID once the list is exhausted
+    uint32_t next();  // moves to the next posting and returns its docID
+    uint32_t nextGEQ(uint32_t target);  // moves to the first docID >= target and returns it
+    uint32_t freq();  // frequency, or impact with IMPACT_MODE, of the current posting
+    double score();  // BM25 contribution of the current posting, in impact levels with IMPACT_MODE
+    uint32_t size() const { return _docNum; }
+    double maxScore() const { return _skips.maxScore(); }  // bound on every score of the list, stored in the lexicon
+    // Bound on the scores of the chunk the cursor is on, 0 once the list is exhausted
+    double blockMaxScore() const { return _docId != (uint32_t)MAX_DOC_ID ? _skips.chunkMaxScore(_chunkIdx) : 0.0; }
+
+    // Block-max moves: only the skip directory is searched, the cursor itself stays where it is
+    void shallowNextGEQ(uint32_t target);  // finds the chunk that would hold target
+    double shallowMaxScore() const { return _shallowChunk < _skips.chunkNum ? _skips.chunkMaxScore(_shallowChunk) : 0.0; }
+    uint32_t shallowLastDocId() const { return _shallowChunk < _skips.chunkNum ? _skips.chunkLastList[_shallowChunk] : MAX_DOC_ID; }
+};
+
+#endif //SEARCHSYSTEM_POSTINGCURSOR_H
@@ -8,53 +8,15 @@ using namespace std;
 
 
 // Constructor for QueryProcessor class
-QueryProcessor::QueryProcessor() = default;
+QueryProcessor::QueryProcessor() {
+    _retrieveContent = RETRIEVE_CONTENT;
+}
 
 
 // Destructor for IndexBuilder class
 QueryProcessor::~QueryProcessor() = default;
 
 
-// Calculates the BM25 score for a given term in a specific document.
-double QueryProcessor::_getBM25(string queryTerm, uint32_t docId, uint32_t freq) {
-    double k1 = 1.2;
-    double b = 0.75;
-    int docIndex;
-    if (INDEX_SUBSET) {
-        docIndex = pageTable.findDocIndex(docId);
-    }
-    else {
-        docIndex = (int)docId;
-    }
-    Document doc = pageTable.pageTable[docIndex]; // Retrieve document information
-    // BM25 scaling factor
-    double K = k1 * ((1 - b) + b * doc.wordCount / pageTable.avgWordCount);
-    // Total number of documents in the corpus
-    int N = (int)pageTable.totalDoc;
-    // Number of documents containing the term
-    double f_t = lexicon.lexiconList[queryTerm].docNum;
-    // Frequency of the term in the current document
-    uint32_t f_dt = freq;
-    // BM25 formula
-    double score = log((N - f_t + 0.5) / (f_t + 0.5)) * (k1 + 1) * f_dt / (K + f_dt);
-    return score;
-}
-
-
-// Calculate the total size of the metadata (docID and frequency lists) for a block
-uint32_t QueryProcessor::_getMetaSize(uint32_t metadataSize, vector<uint32_t> &lastDocIdList,
-                                      vector<uint32_t> &docIdSizeList, vector<uint32_t> &freqSizeList) {
-    uint32_t size = 0;
-    // Add size of the metadata (number of blocks and the sizes of docID/frequency lists)
-    size += sizeof(metadataSize) + 3 * sizeof(uint32_t) * metadataSize;
-    // Add the size of each docID and frequency block
-    for (int i = 0; i < metadataSize; i++){
-        size += docIdSizeList[i] + freqSizeList[i];
-    }
-    return size;  // Return the total size of the block
-}
-
-
 string QueryProcessor::_readDocContent(uint32_t docId, bool stripDocID = true) {
     // Find the index of docId in the pageTable
     int docIndex;
@@ -68,12 +30,18 @@ string QueryProcessor::_readDocContent(uint32_t docId, bool stripDocID = true) {
         docIndex = static_cast<int>(docId);
     }
 
+    // The document store holds the served text already: no docID prefix, BEIR title and text
+    if (DOC_STORE_MODE) {
+        return documentStore.get(docIndex);
+    }
+
     // Open the dataset file to read the content
+    const char *datasetPath = (CORPUS_FORMAT == CORPUS_FORMAT_BEIR) ? BEIR_CORPUS_PATH : DATA_SOURCE_PATH;
     ifstream datasetFile;
     if (FILE_MODE_BIN) {
-        datasetFile.open(DATA_SOURCE_PATH, ios::in | ios::binary);  // Open in binary mode
+        datasetFile.open(datasetPath, ios::in | ios::binary);  // Open in binary mode
     } else {
-        datasetFile.open(DATA_SOURCE_PATH, ios::in);  // Open in text mode
+        datasetFile.open(datasetPath, ios::in);  // Open in text mode
     }
     if (!datasetFile.is_open()) {
         cerr << "Error opening dataset file" << endl;
@@ -81,8 +49,8 @@ string QueryProcessor::_readDocContent(uint32_t docId, bool stripDocID = true) {
     }
 
     // Fetch the document position and data length from the PageTable
-    streamoff docPos = pageTable.pageTable[docIndex].docPos;
-    uint32_t dataLength = pageTable.pageTable[docIndex].dataLength;
+    streamoff docPos = pageTable.docPosList[docIndex];
+    uint32_t dataLength = pageTable.dataLengthList[docIndex];
 
     // Seek to the document position
     datasetFile.seekg(docPos, ios::beg);
@@ -98,6 +66,15 @@ string QueryProcessor::_readDocContent(uint32_t docId, bool stripDocID = true) {
     // Close the dataset file
     datasetFile.close();
 
+    // BEIR documents are stored as a JSON line, serve the title and text
+    if (CORPUS_FORMAT == CORPUS_FORMAT_BEIR) {
+        map<string, string> fields;
+        if (BeirReader::parseLine(content, fields)) {
+            content = BeirReader::getDocumentText(fields);
+        }
+        return content;
+    }
+
     // If stripDocID is true, remove the docID from the beginning of the content
     if (stripDocID) {
         size_t firstTab = content.find('\t');
@@ -134,166 +111,18 @@ vector<string> QueryProcessor::_splitQuery(const string& query) {
 }
 
 
-// Reads metadata from the index file using mmap for efficient I/O
-void QueryProcessor::_openList(uint32_t offset,
-                               uint32_t &metadataSize,
-                               vector<uint32_t> &lastDocIdList,
-                               vector<uint32_t> &docIdSizeList,
-                               vector<uint32_t> &freqSizeList) {
-    lastDocIdList.clear();
-    docIdSizeList.clear();
-    freqSizeList.clear();
-    int index_fd = open(lexicon.indexPath.c_str(), O_RDONLY);  // Open index file
-
-    off_t pa_offset = offset & ~(sysconf(_SC_PAGE_SIZE) - 1);  // Align offset to the page boundary
-    size_t length = MAX_META_SIZE;
-    struct stat fileStats;
-    // Check if the file size is valid before proceeding with mmap
-    if (fstat(index_fd, &fileStats) == -1) {
-        perror("Error getting file size with fstat");
-        close(index_fd);
-        return;
-    }
-
-    // Adjust the length if it exceeds the file size
-    if (offset + length > fileStats.st_size)
-        length = fileStats.st_size - offset;
-    // Execute mmap: Memory-map the file for efficient data access
-    char *mapped_memory = (char *)mmap(NULL, length + offset - pa_offset, PROT_READ, MAP_PRIVATE, index_fd, pa_offset);
-    if (mapped_memory == MAP_FAILED) {
-        close(index_fd);
-        perror("mmap failed");
-        return;
-    }
-
-    // Read metadata for the current block
-    int startIndex = offset - pa_offset;
-    memcpy(&metadataSize, mapped_memory + startIndex, sizeof(metadataSize));  // Read metadata size
-
-    startIndex += sizeof(metadataSize);
-
-    // Extract last document IDs, document sizes, and frequency sizes for the block
-    for (int i = 0; i < metadataSize; i++) {
-        uint32_t lastDocId;
-        memcpy(&lastDocId, mapped_memory + startIndex, sizeof(lastDocId));
-        lastDocIdList.push_back(lastDocId);
-        startIndex += sizeof(lastDocId);
-    }
-    for (int i = 0; i < metadataSize; i++) {
-        uint32_t docIdSize;
-        memcpy(&docIdSize, mapped_memory + startIndex, sizeof(docIdSize));
-        docIdSizeList.push_back(docIdSize);
-        startIndex += sizeof(docIdSize);
+// Cursor over the postings of one term; terms not in the index get an empty cursor
+PostingCursor QueryProcessor::_openCursor(const string &term) {
+    LexiconItem lexItem = lexicon.getItem(term);
+    if (lexItem.blockNum == 0) {
+        return PostingCursor();
     }
-    for (int i = 0; i < metadataSize; i++) {
-        uint32_t freqSize;
-        memcpy(&freqSize, mapped_memory + startIndex, sizeof(freqSize));
-        freqSizeList.push_back(freqSize);
-        startIndex += sizeof(freqSize);
+    if (lexItem.endPos > lexicon.indexSize()) {
+        cerr << "Postings of " << term << " are past the end of the index" << endl;
+        return PostingCursor();
     }
-    // Unmap the memory-mapped file and close it
-    munmap(mapped_memory, length + offset - pa_offset);
-    close(index_fd);
-}
-
-
-vector<pair<uint32_t, uint32_t>> QueryProcessor::_getPostingsList(string term) {
-    vector<pair<uint32_t, uint32_t>> postingsList;
-    // Extract term's block data from the lexicon
-    uint32_t beginPos = lexicon.lexiconList[term].beginPos;
-    uint32_t endPos = lexicon.lexiconList[term].endPos;
-    uint32_t blockNum = lexicon.lexiconList[term].blockNum;
-
-    // Loop through the blocks to decode postings
-    for (int i = 0; i < blockNum; i++) {
-        uint32_t metadataSize;
-        vector<uint32_t> lastDocIdList, docIdSizeList, freqSizeList;
-
-        // Open the block and get metadata
-        _openList(beginPos, metadataSize, lastDocIdList, docIdSizeList, freqSizeList);
-
-        // For each block, decode the postings list
-        for (int j = 0; j < metadataSize; j++) {
-            vector<uint32_t> docIDs = _decodeChunkToIntList(beginPos, beginPos + docIdSizeList[j]);
-            vector<uint32_t> freqs = _decodeChunkToIntList(beginPos + docIdSizeList[j], beginPos + docIdSizeList[j] + freqSizeList[j]);
-
-            // Combine docIDs and freqs into pairs and add to postings list
-            for (int k = 0; k < docIDs.size(); k++) {
-                postingsList.emplace_back(docIDs[k], freqs[k]);
-            }
-        }
-
-        // Move to the next block
-        beginPos += _getMetaSize(metadataSize, lastDocIdList, docIdSizeList, freqSizeList);
-    }
-
-    return postingsList;
-}
-
-
-// Frequency retrieval of a term in a specific document
-uint32_t QueryProcessor::_getFreq(string term, uint32_t docId) {
-    // Get the postings list for the term
-    vector<pair<uint32_t, uint32_t>> postingsList = _getPostingsList(term);
-
-    // Search for the document ID in the postings list
-    for (auto &posting : postingsList) {
-        if (posting.first == docId) {
-            return posting.second;  // Return the frequency
-        }
-    }
-
-    // If docID is not found, return 0
-    return 0;
-}
-
-
-// Decodes a chunk of varbyte-encoded data and returns a list of integers
-// This function is used to decode either DocId or Freq chunks from the index file
-vector<uint32_t> QueryProcessor::_decodeChunkToIntList(uint32_t offset, uint32_t endPos) {
-    int index_fd = open(lexicon.indexPath.c_str(), O_RDONLY);  // Open the index file in read-only mode
-    // page align offset
-    off_t pa_offset = offset & ~(sysconf(_SC_PAGE_SIZE) - 1);  // Align offset to the system's page size
-    size_t length = endPos - offset;  // Calculate the length to be read from the file
-    struct stat fileStats;
-
-    // Adjust the length if it exceeds the file size
-    if (offset + length > fileStats.st_size)
-        length = fileStats.st_size - offset;
-
-    // Memory-map the file for efficient I/O to avoid reading large blocks directly into memoryMemory
-    char *mapped_memory = (char *)mmap(NULL, length + offset - pa_offset, PROT_READ, MAP_PRIVATE, index_fd, pa_offset);
-    if (mapped_memory == MAP_FAILED) {
-        close(index_fd);
-        perror("Memory mapping failed");
-    }
-
-    vector<uint32_t> decodedIntegers;  // To store decoded integers
-    uint32_t currentInt = 0;
-    int shift = 0;
-    uint8_t byte;
-    int startIndex = offset - pa_offset;
-
-    // Varbyte decoding logic, reconstructing integers from encoded bytes
-    for (uint32_t i = offset; i < endPos; i++) {
-        memcpy(&byte, mapped_memory + startIndex, sizeof(byte));  // Copy each byte
-        startIndex += sizeof(byte);
-        currentInt |= (byte & 0x7F) << shift;
-        if ((byte & 0x80) == 0) { // Check the high bit
-            decodedIntegers.push_back(currentInt);
-            currentInt = 0;
-            shift = 0;
-        }
-        else {
-            shift += 7;
-        }
-    }
-
-    // Unmap the memory-mapped file and close the file descriptor
-    munmap(mapped_memory, length + offset - pa_offset);
-    close(index_fd);
-
-    return decodedIntegers;  // Return the list of decoded integers
+    return PostingCursor(lexicon.indexData() + lexItem.beginPos, lexItem.beginPos, lexicon.skipDirectory(lexItem),
+                         lexItem.codec, lexItem.docNum, &pageTable);
 }
 
 
@@ -305,7 +134,7 @@ void QueryProcessor::_getMapTopK(map<uint32_t, double> &docScoreMap, int k) {
     // Iterate through the score array and maintain the top-k elements in the priority queue
     for (const auto& [docId, score] : docScoreMap) {
         minHeap.emplace(score, docId);  // Add the current score and its docID
-        if (minHeap.size() > k) {
+        if (minHeap.size() > (size_t)k) {
             minHeap.pop();  // Remove the lowest score when we exceed k elements
         }
     }
@@ -321,9 +150,9 @@ void QueryProcessor::_getListTopK(vector<double> &scoreList, int k) {
     priority_queue<DocScoreEntry> minHeap;
 
     // Maintain a priority queue to track the top-k elements
-    for (int i = 0; i < scoreList.size(); i++) {
+    for (size_t i = 0; i < scoreList.size(); i++) {
         minHeap.emplace(scoreList[i], i);
-        if (minHeap.size() > k) {
+        if (minHeap.size() > (size_t)k) {
             minHeap.pop();
         }
     }
@@ -333,393 +162,596 @@ void QueryProcessor::_getListTopK(vector<double> &scoreList, int k) {
 }
 
 
-// Decodes a single block of postings for a term and updates the score hash map
-void QueryProcessor::_decodeOneBlockToMap(string minTerm, uint32_t &beginPos, map<uint32_t, double> &docScoreMap) {
-    uint32_t metadataSize;  // Number of documents in the block
-    vector<uint32_t> lastDocIdList, docIdSizeList, freqSizeList;
-    // Retrieve metadata (document IDs, sizes, and frequencies for the block)
-    _openList(beginPos, metadataSize, lastDocIdList, docIdSizeList, freqSizeList);
-
-    // Prepare to decode docID and frequency chunks
-    vector<uint32_t> docId64, freq64;
-    uint32_t metaByte = 4 + 3 * (metadataSize) * 4;  // Offset for metadata in the block
-    uint32_t docIdPos = beginPos + metaByte;  // Starting position for docID chunk
-    uint32_t freqPos = docIdPos + docIdSizeList[0];  // Starting position for frequency chunk
-
-    // Loop through each document in the block and decode its docID and frequency
-    for (int i = 0; i < metadataSize; i++) {
-        // Decode the chunk of docIDs and frequencies
-        docId64 = _decodeChunkToIntList(docIdPos, docIdPos + docIdSizeList[i]);  // Decode docIDs for the block
-        freq64 = _decodeChunkToIntList(freqPos, freqPos + freqSizeList[i]);  // Decode frequencies for the block
-        // If not the last document, update pointers for the next docID and frequency chunks
-        if (i != metadataSize - 1) {
-            docIdPos += docIdSizeList[i] + freqSizeList[i];  // Move docID pointer to the next block
-            freqPos += freqSizeList[i] + docIdSizeList[i + 1];  // Move frequency pointer
-        }
-
-        // init score
-        // For each document in this chunk, accumulate the BM25 score using the decoded docID and frequency
-        uint32_t originDocId = 0;  // Used to reconstruct the original docIDs from deltas
-        for (int j = 0; j < docId64.size(); j++) {
-            originDocId += docId64[j];  // Reconstruct original document IDs from deltas
-            // Insert score for each document
-            docScoreMap[originDocId] = _getBM25(minTerm, originDocId, freq64[j]);
-        }
-    }
-
-    // Move to the next block
-    beginPos += _getMetaSize(metadataSize, lastDocIdList, docIdSizeList, freqSizeList);
-}
-
-
-void QueryProcessor::_decodeBlocksToMap(string minTerm, map<uint32_t, double> &docScoreMap) {
-    uint32_t beginPos = lexicon.lexiconList[minTerm].beginPos;
-//    uint32_t endPos = lexicon.lexiconList[minTerm].endPos;
-    uint32_t blockNum = lexicon.lexiconList[minTerm].blockNum;
-
-    for (int i = 0; i < blockNum; i++) {
-        _decodeOneBlockToMap(minTerm, beginPos, docScoreMap);
-    }
-}
-
-
-// Updates the score hash for the given term, ensuring only documents common to all terms remain
-void QueryProcessor::_updateScoreMap(string term, map<uint32_t, double> &docScoreMap) {
-    vector<uint32_t> docIdList, freqList;
-
-    // Decode all blocks for the given term
-    _decodeBlocks(term, docIdList, freqList);
-
-    // Iterate through the documents in docScoreMap
-    auto it = docScoreMap.begin();
-    size_t docIdPos = 0;
-
-    // For each document in the map, check if it's in the decoded list
-    while (it != docScoreMap.end()) {
-        uint32_t docId = it->first;
-        bool found = false;
-
-        // Move through the decoded docIdList until we find or pass the current docId
-        while (docIdPos < docIdList.size()) {
-            if (docIdList[docIdPos] == docId) {
-                // Document found, update the score
-                docScoreMap[docId] += _getBM25(term, docId, freqList[docIdPos]);
-                found = true;
-                ++docIdPos;  // Move to the next document in the list
-                break;
-            } else if (docIdList[docIdPos] > docId) {
-                // Stop early since the current docID in docIdList is greater than the one in docScoreMap
-                break;
-            }
-            ++docIdPos;
-        }
-
-        // If not found, remove it from the map
-        if (!found) {
-            it = docScoreMap.erase(it);
-        } else {
-            ++it;  // Move to the next document in the map
-        }
-    }
-}
-
-
-// Decodes a single block of postings and updates the score array
-void QueryProcessor::_decodeOneBlockToList(string term, uint32_t &beginPos, vector<double> &scoreList) {
-    uint32_t metadataSize;
-    vector<uint32_t> lastDocIdList, docIdSizeList, freqSizeList;
-    // Read the metadata
-    _openList(beginPos, metadataSize, lastDocIdList, docIdSizeList, freqSizeList);
-
-    // Decode docID and frequency chunks
-    vector<uint32_t> docId64, freq64;
-    uint32_t metaByte = 4 + 3 * (metadataSize)*4;
-    uint32_t docIdPos = beginPos + metaByte;
-    uint32_t freqPos = docIdPos + docIdSizeList[0];
-
-    for (int i = 0; i < metadataSize; i++) {
-        docId64 = _decodeChunkToIntList(docIdPos, docIdPos + docIdSizeList[i]);  // Decode docID list
-        freq64 = _decodeChunkToIntList(freqPos, freqPos + freqSizeList[i]);  // Decode frequency list
-        if (i != metadataSize - 1) {
-            docIdPos += docIdSizeList[i] + freqSizeList[i];
-            freqPos += freqSizeList[i] + docIdSizeList[i + 1];
-        }
-
-        // Increment document IDs and update scores using BM25
-        uint32_t originDocId = 0;
-        for (int j = 0; j < docId64.size(); j++) {
-            originDocId += docId64[j];  // Reconstruct DocID for delta encoding
-            scoreList[originDocId] += _getBM25(term, originDocId, freq64[j]);
-        }
-    }
-
-    // Update the start position for the next block
-    beginPos += _getMetaSize(metadataSize, lastDocIdList, docIdSizeList, freqSizeList);
-}
-
-
-// Decodes posting blocks for a given term and updates the score array
-void QueryProcessor::_decodeBlocksToList(string term, vector<double> &docScoreList) {
-    uint32_t beginPos = lexicon.lexiconList[term].beginPos;
-    uint32_t endPos = lexicon.lexiconList[term].endPos;
-    uint32_t blockNum = lexicon.lexiconList[term].blockNum;
-    for (int i = 0; i < blockNum; i++) {
-        _decodeOneBlockToList(term, beginPos, docScoreList);  // Decode each block
-    }
-}
-
-
 // Handles Term-At-A-Time (TAAT) query processing, supporting disjunctive (OR) and conjunctive (AND) queries
 void QueryProcessor::_queryTAAT(vector<string> wordList, int queryMode) {
     _searchResultList.clear();  // Clear previous search results
 
     if (queryMode == DISJUNCTIVE) {  // OR query
-        vector<double> scoreList(pageTable.totalDoc, 0);  // Array to hold BM25 scores, same size as pageTable
-        // Iterate through each term and calculate its score
+        // Array to hold BM25 scores, indexed by docID; with INDEX_SUBSET the docIDs go past the number of documents
+        vector<double> scoreList(pageTable.totalDoc ? pageTable.docIdList[pageTable.totalDoc - 1] + 1 : 0, 0);
+        // Every posting of every term adds its score to the document's accumulator
         for (const auto& queryTerm : wordList) {
-            try {
-                _decodeBlocksToList(queryTerm, scoreList);  // Update score array using the term's contribution
-            }
-            catch (...) {
-                cerr << "exception" << endl;
+            lexicon.adviseList(lexicon.getItem(queryTerm), MADV_WILLNEED);  // the whole list is read: read its pages ahead
+            PostingCursor cursor = _openCursor(queryTerm);
+            for (uint32_t docId = cursor.docId(); docId != (uint32_t)MAX_DOC_ID; docId = cursor.next()) {
+                scoreList[docId] += cursor.score();
             }
         }
         // Select the top-k highest scores
-        _getListTopK(scoreList, NUM_TOP_RESULT);
+        _getListTopK(scoreList, NUM_TOP_CANDIDATE);
     }
     else if (queryMode == CONJUNCTIVE) {  // AND query
         // find the query term with least docNum
         string minTerm = wordList[0];  // Initialize with the first term
-        uint32_t minDocNum = lexicon.lexiconList[minTerm].docNum;  // Number of documents containing the term
+        uint32_t minDocNum = lexicon.getItem(minTerm).docNum;  // Number of documents containing the term
         // Find the term with the smallest number of documents
-        for (int i = 1; i < wordList.size(); i++) {
+        for (size_t i = 1; i < wordList.size(); i++) {
             string term = wordList[i];
-            if (lexicon.lexiconList[term].docNum < minDocNum) {
+            uint32_t docNum = lexicon.getItem(term).docNum;
+            if (docNum < minDocNum) {
                 minTerm = term;
-                minDocNum = lexicon.lexiconList[term].docNum;
+                minDocNum = docNum;
             }
         }
 
         // Build the initial score hash map based on the smallest term
         map<uint32_t, double> docScoreMap;
-        _decodeBlocksToMap(minTerm, docScoreMap);
+        PostingCursor minCursor = _openCursor(minTerm);
+        for (uint32_t docId = minCursor.docId(); docId != (uint32_t)MAX_DOC_ID; docId = minCursor.next()) {
+            docScoreMap[docId] = minCursor.score();
+        }
 
-        // Update score hash with other terms
+        // Probe the other terms at the candidates only, dropping the documents they do not contain;
+        // the chunks between two candidates are skipped without being decoded
         for (const string& queryTerm : wordList) {
             if (queryTerm == minTerm)
                 continue;
-            try {
-                _updateScoreMap(queryTerm, docScoreMap);
-            }
-            catch (...) {
-                cerr << "exception occurred while updating score map for term: " << queryTerm << endl;
+            PostingCursor cursor = _openCursor(queryTerm);
+            for (auto it = docScoreMap.begin(); it != docScoreMap.end();) {
+                if (cursor.nextGEQ(it->first) == it->first) {
+                    it->second += cursor.score();
+                    ++it;
+                } else {
+                    it = docScoreMap.erase(it);
+                }
             }
         }
 
         // Retrieve the top-k results
-        _getMapTopK(docScoreMap, NUM_TOP_RESULT);
+        _getMapTopK(docScoreMap, NUM_TOP_CANDIDATE);
     }
-    // index_infile.close();
 }
 
 
-void QueryProcessor::_decodeOneBlock(string term, uint32_t& beginPos, vector<uint32_t>& docIdList, vector<uint32_t>& freqList) {
-    uint32_t metadataSize;
-    vector<uint32_t> lastDocIdList, docIdSizeList, freqSizeList;
-    // Read the metadata
-    _openList(beginPos, metadataSize, lastDocIdList, docIdSizeList, freqSizeList);
+// DAAT conjunctive query on dense lists: the matching docIDs come from intersecting their Roaring containers,
+// a word-parallel AND wherever two bitmaps meet, and each list is entered only at the ranks of those docIDs
+// to read their frequencies
+void QueryProcessor::_queryConjunctiveRoaring(vector<string> wordList) {
+    vector<RoaringList> roaringLists;
+    vector<uint32_t> docNumList;  // documents of every term, for BM25: looked up once, not per match
+    roaringLists.reserve(wordList.size());
+    for (size_t i = 0; i < wordList.size(); ++i) {
+        LexiconItem lexItem = lexicon.getItem(wordList[i]);
+        docNumList.push_back(lexItem.docNum);
+        uint64_t containerPos = 0;
+        lexicon.findContainers(lexItem, containerPos);
+        // Only the containers and the frequency chunks of the matches are read from the mapped index
+        roaringLists.emplace_back(lexicon.indexData() + lexItem.beginPos, lexItem.beginPos, lexicon.skipDirectory(lexItem),
+                                  lexItem.codec, lexicon.indexData() + containerPos, lexItem.endPos - containerPos);
+    }
+
+    vector<const RoaringSet *> setList;
+    for (const RoaringList &list : roaringLists) {
+        setList.push_back(&list.set());
+    }
+    vector<uint32_t> docIdList;
+    RoaringSet::intersect(setList, docIdList);
+
+    map<uint32_t, double> docScoreMap;
+    for (uint32_t docId : docIdList) {
+        double totalScore = 0.0;
+        for (size_t i = 0; i < roaringLists.size(); ++i) {
+            roaringLists[i].nextGEQ(docId);
+            // Scored like PostingCursor::score: impacts are stored as they are
+            uint32_t freq = roaringLists[i].freq();
+            totalScore += IMPACT_MODE ? freq : pageTable.getBM25(docId, docNumList[i], freq);
+        }
+        docScoreMap[docId] = totalScore;
+    }
 
-    // Decode docID and frequency chunks
-    vector<uint32_t> docId64, freq64;
-    uint32_t metaByte = 4 + 3 * (metadataSize)*4;
-    uint32_t docIdPos = beginPos + metaByte;
-    uint32_t freqPos = docIdPos + docIdSizeList[0];
+    _getMapTopK(docScoreMap, NUM_TOP_CANDIDATE);  // Rank and retrieve the top K results
+}
 
-    for (int i = 0; i < metadataSize; i++) {
-        docId64 = _decodeChunkToIntList(docIdPos, docIdPos + docIdSizeList[i]);  // Decode docID list
-        freq64 = _decodeChunkToIntList(freqPos, freqPos + freqSizeList[i]);  // Decode frequency list
-        if (i != metadataSize - 1) {
-            docIdPos += docIdSizeList[i] + freqSizeList[i];
-            freqPos += freqSizeList[i] + docIdSizeList[i + 1];
-        }
 
-        // Increment document IDs and update docIdList and freqList
-        uint32_t originDocId = 0;
-        for (int j = 0; j < docId64.size(); j++) {
-            originDocId += docId64[j];  // Reconstruct DocID for delta encoding
+void QueryProcessor::_queryDAAT(vector<string> wordList, int queryMode, int algorithm) {
+    _searchResultList.clear();  // Clear previous results
 
-            docIdList.push_back(originDocId);  // Append the decoded docID to docIdList
-            freqList.push_back(freq64[j]);  // Append the corresponding frequency to freqList
+    if (queryMode == CONJUNCTIVE && ROARING_MODE) {
+        // Dense lists are intersected on their containers, without touching their docID chunks
+        bool dense = true;
+        uint64_t containerPos;
+        for (const string &word : wordList) {
+            dense = dense && lexicon.findContainers(lexicon.getItem(word), containerPos);
+        }
+        if (dense) {
+            _queryConjunctiveRoaring(wordList);
+            return;
         }
     }
 
-    // Update the start position for the next block
-    beginPos += _getMetaSize(metadataSize, lastDocIdList, docIdSizeList, freqSizeList);
-}
-
-
-void QueryProcessor::_decodeBlocks(string term, vector<uint32_t>& docIdList, vector<uint32_t>& freqList) {
-    uint32_t beginPos = lexicon.lexiconList[term].beginPos;
-    uint32_t endPos = lexicon.lexiconList[term].endPos;
-    uint32_t blockNum = lexicon.lexiconList[term].blockNum;
-    for (int i = 0; i < blockNum; i++) {
-        _decodeOneBlock(term, beginPos, docIdList, freqList);  // Decode each block
+    vector<PostingCursor> cursors;
+    cursors.reserve(wordList.size());
+    for (const string &word : wordList) {
+        cursors.push_back(_openCursor(word));
     }
-}
 
+    if (queryMode == CONJUNCTIVE) {
+        // Conjunctive (AND) query processing: the rarest list drives, the others are only probed with
+        // nextGEQ, so the cost follows the length of the rarest list
+        map<uint32_t, double> docScoreMap;  // Map to store document scores for conjunctive queries
+        vector<int> order(cursors.size());
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [&cursors](int a, int b) {
+            return cursors[a].size() < cursors[b].size();
+        });
+        PostingCursor &driver = cursors[order[0]];
+
+        uint32_t docId = driver.docId();
+        while (docId != (uint32_t)MAX_DOC_ID) {
+            // Probe the longer lists; stop at the first one that does not contain docId
+            uint32_t furthestDocID = docId;
+            for (size_t i = 1; i < order.size() && furthestDocID == docId; ++i) {
+                furthestDocID = cursors[order[i]].nextGEQ(docId);
+            }
+
+            if (furthestDocID == docId) {
+                // All terms match at docId, so calculate and store the score
+                double totalScore = 0.0;
+                for (PostingCursor &cursor : cursors) {
+                    totalScore += cursor.score();
+                }
+                docScoreMap[docId] = totalScore;  // Store the score in the map
+                furthestDocID = docId + 1;
+            }
+            docId = (furthestDocID == (uint32_t)MAX_DOC_ID) ? furthestDocID : driver.nextGEQ(furthestDocID);
+        }
 
-// binary search
-uint32_t QueryProcessor::_nextGEQ(const vector<uint32_t>& docIDList, uint32_t currentDocID) {
-    // Use binary search to find the first docID >= currentDocID
-    auto it = lower_bound(docIDList.begin(), docIDList.end(), currentDocID);
+        // Retrieve the top-k results
+        _getMapTopK(docScoreMap, NUM_TOP_CANDIDATE);  // Rank and retrieve the top K results
+    }
 
-    if (it != docIDList.end()) {
-        return *it;  // Return the document ID found
+    else if (queryMode == DISJUNCTIVE) {
+        // Disjunctive (OR) query processing
+        for (const string &word : wordList) {
+            lexicon.adviseList(lexicon.getItem(word), MADV_WILLNEED);  // every posting is read: read the pages ahead
+        }
+        if (!scoreBounds) {
+            _exhaustiveTopK(cursors);
+        } else if (algorithm == DISJUNCTIVE_WAND) {
+            _wandTopK(cursors);
+        } else if (algorithm == DISJUNCTIVE_BMW) {
+            _blockMaxWandTopK(cursors);
+        } else if (algorithm == DISJUNCTIVE_BMM) {
+            _blockMaxMaxScoreTopK(cursors);
+        } else {
+            _maxScoreTopK(cursors);
+        }
     }
-    return MAX_DOC_ID;  // If no docID >= currentDocID, return the sentinel value
 }
 
 
-void QueryProcessor::_queryDAAT(vector<string> wordList, int queryMode) {
-    _searchResultList.clear();  // Clear previous results
+// MaxScore: lists are sorted by their score bound, and the longest prefix whose bounds add up to at most the
+// threshold is non-essential. A document only in those lists cannot enter the top K, so candidates come from
+// the essential lists alone, and the non-essential ones are probed with nextGEQ, highest bound first, until
+// the candidate's bound falls to the threshold. Rank-safe: the top K is the one of the exhaustive union.
+void QueryProcessor::_maxScoreTopK(vector<PostingCursor>& cursors) {
+    priority_queue<DocScoreEntry> topKHeap;  // Priority queue to store top-K scores
+    size_t termNum = cursors.size();
+
+    // Step 1: Order the lists by score bound, stored in the lexicon, and sum the bounds of every prefix
+    vector<int> order(termNum);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&cursors](int a, int b) {
+        return cursors[a].maxScore() < cursors[b].maxScore();
+    });
+    vector<double> boundSums(termNum);  // bounds of the lists order[0..i]
+    for (size_t i = 0; i < termNum; ++i) {
+        boundSums[i] = (i ? boundSums[i - 1] : 0.0) + cursors[order[i]].maxScore();
+    }
+    size_t firstEssential = 0;  // order[0..firstEssential) are non-essential
+    vector<double> termScores(termNum);  // contribution of every term to the current candidate
+
+    while (firstEssential < termNum) {
+        // Step 2: The next candidate is the smallest docID of the essential lists
+        uint32_t docId = MAX_DOC_ID;
+        for (size_t i = firstEssential; i < termNum; ++i) {
+            docId = min(docId, cursors[order[i]].docId());
+        }
+        if (docId == (uint32_t)MAX_DOC_ID) {
+            break;  // No more documents to process
+        }
 
-    vector<uint32_t> beginPositions(wordList.size());  // Store the start positions for each term
-    vector<uint32_t> endPositions(wordList.size());
-    vector<uint32_t> blockNums(wordList.size());
-    vector<vector<uint32_t>> docIDLists(wordList.size()), freqLists(wordList.size());
+        // Step 3: Score it in the essential lists, then in the non-essential ones while it can still make the top K
+        fill(termScores.begin(), termScores.end(), 0.0);
+        double score = 0.0;
+        for (size_t i = firstEssential; i < termNum; ++i) {
+            PostingCursor &cursor = cursors[order[i]];
+            if (cursor.docId() == docId) {
+                termScores[order[i]] = cursor.score();
+                score += termScores[order[i]];
+                cursor.next();
+            }
+        }
+        bool full = topKHeap.size() == NUM_TOP_CANDIDATE;
+        bool pruned = false;
+        for (size_t i = firstEssential; i-- > 0;) {
+            if (full && score + boundSums[i] <= topKHeap.top().score) {
+                pruned = true;
+                break;
+            }
+            PostingCursor &cursor = cursors[order[i]];
+            if (cursor.nextGEQ(docId) == docId) {
+                termScores[order[i]] = cursor.score();
+                score += termScores[order[i]];
+            }
+        }
+        if (pruned) {
+            continue;
+        }
 
-    // Initialize begin positions from the lexicon
-    for (int i = 0; i < wordList.size(); ++i) {
-        beginPositions[i] = lexicon.lexiconList[wordList[i]].beginPos;
-        endPositions[i] = lexicon.lexiconList[wordList[i]].endPos;
-        blockNums[i] = lexicon.lexiconList[wordList[i]].blockNum;
-    }
+        // Step 4: Insert the score into top-K heap if it exceeds the threshold; summed in query order, as the
+        // exhaustive union would
+        double totalScore = accumulate(termScores.begin(), termScores.end(), 0.0);
+        if (!full || totalScore > topKHeap.top().score) {
+            topKHeap.emplace(totalScore, docId);
+            if (topKHeap.size() > NUM_TOP_CANDIDATE) {
+                topKHeap.pop();  // Maintain only top-K results
+            }
+        }
 
-    // Decode the docID and frequency lists for each term in wordList
-    for (int i = 0; i < wordList.size(); ++i) {
-        _decodeBlocks(wordList[i], docIDLists[i], freqLists[i]);  // Decode each term's blocks
+        // Step 5: Lists whose bounds cannot reach the threshold together become non-essential
+        if (topKHeap.size() == NUM_TOP_CANDIDATE) {
+            while (firstEssential < termNum && boundSums[firstEssential] <= topKHeap.top().score) {
+                firstEssential++;
+            }
+        }
     }
 
-    if (queryMode == CONJUNCTIVE) {
-        // Conjunctive (AND) query processing
-        map<uint32_t, double> docScoreMap;  // Map to store document scores for conjunctive queries
-        vector<uint32_t> currentDocIDs(wordList.size(), 0);
+    // Output top-K results
+    _outputTopKResults(topKHeap);
+}
+
+
+// WAND: the lists are kept sorted by current docID, and the pivot is the first list at which the bounds of the
+// lists so far add up to more than the threshold. No document before the pivot's docID can enter the top K, so
+// the lists before the pivot jump to it with nextGEQ; the pivot is scored once all of them have reached it.
+// Rank-safe: the top K is the one of the exhaustive union.
+void QueryProcessor::_wandTopK(vector<PostingCursor>& cursors) {
+    priority_queue<DocScoreEntry> topKHeap;  // Priority queue to store top-K scores
+    size_t termNum = cursors.size();
+    vector<double> maxScores(termNum);  // Max score for each term, stored in the lexicon
+    for (size_t i = 0; i < termNum; ++i) {
+        maxScores[i] = cursors[i].maxScore();
+    }
+    vector<int> order(termNum);  // lists by current docID
+    iota(order.begin(), order.end(), 0);
+    auto byDocId = [&cursors](int a, int b) { return cursors[a].docId() < cursors[b].docId(); };
+    sort(order.begin(), order.end(), byDocId);
+    auto bubble = [&](size_t i) {  // puts order[i] back in docID order after it moved forward
+        for (; i + 1 < termNum && byDocId(order[i + 1], order[i]); ++i) {
+            swap(order[i], order[i + 1]);
+        }
+    };
+    vector<double> termScores(termNum);  // contribution of every term to the current pivot
 
-        // Initialize currentDocIDs with the first docID from each list
-        for (int i = 0; i < wordList.size(); ++i) {
-            currentDocIDs[i] = docIDLists[i][0];
+    while (true) {
+        // Step 1: Find the pivot; until the heap is full every document is a candidate
+        bool full = topKHeap.size() == NUM_TOP_CANDIDATE;
+        double boundSum = 0.0;
+        size_t pivot = termNum;
+        for (size_t i = 0; i < termNum && cursors[order[i]].docId() != (uint32_t)MAX_DOC_ID; ++i) {
+            boundSum += maxScores[order[i]];
+            if (!full || boundSum > topKHeap.top().score) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == termNum) {
+            break;  // No document left can beat the threshold
+        }
+        uint32_t pivotDocId = cursors[order[pivot]].docId();
+        while (pivot + 1 < termNum && cursors[order[pivot + 1]].docId() == pivotDocId) {
+            pivot++;  // lists already at the pivot docID add their score too
         }
 
-        uint32_t furthestDocID = *max_element(currentDocIDs.begin(), currentDocIDs.end());  // Start with the maximum docID
+        if (cursors[order[0]].docId() == pivotDocId) {
+            // Step 2: Every list up to the pivot is at pivotDocId: score it, summed in query order
+            fill(termScores.begin(), termScores.end(), 0.0);
+            for (size_t i = 0; i <= pivot; ++i) {
+                termScores[order[i]] = cursors[order[i]].score();
+                cursors[order[i]].next();
+            }
+            double totalScore = accumulate(termScores.begin(), termScores.end(), 0.0);
+            if (!full || totalScore > topKHeap.top().score) {
+                topKHeap.emplace(totalScore, pivotDocId);
+                if (topKHeap.size() > NUM_TOP_CANDIDATE) {
+                    topKHeap.pop();  // Maintain only top-K results
+                }
+            }
+            for (size_t i = pivot + 1; i-- > 0;) {
+                bubble(i);
+            }
+        }
+        else {
+            // Step 3: Move the last list before the pivot docID up to it, and put it back in docID order
+            size_t i = pivot;
+            while (cursors[order[i]].docId() == pivotDocId) {
+                i--;
+            }
+            cursors[order[i]].nextGEQ(pivotDocId);
+            bubble(i);
+        }
+    }
 
-        while (furthestDocID != MAX_DOC_ID) {
+    // Output top-K results
+    _outputTopKResults(topKHeap);
+}
 
-            bool allMatch = true;
 
-            // Iterate through each list and advance the pointers
-            for (int i = 0; i < wordList.size(); ++i) {
-                // Move each list to the next docID >= furthestDocID
-                uint32_t previousDocID = currentDocIDs[i];  // Save the previous docID for debug purposes
-                currentDocIDs[i] = _nextGEQ(docIDLists[i], furthestDocID);
+// Block-Max WAND: the pivot is found as in WAND, then checked against the bounds of the chunks that would hold
+// it, found in the skip directories without decoding. When those bounds cannot beat the threshold, no document
+// up to the end of the shortest of these chunks can either, and the list with the largest bound jumps past it.
+// Scoring stops as soon as the chunk bounds left cannot lift the document above the threshold.
+void QueryProcessor::_blockMaxWandTopK(vector<PostingCursor>& cursors) {
+    priority_queue<DocScoreEntry> topKHeap;  // Priority queue to store top-K scores
+    size_t termNum = cursors.size();
+    vector<double> maxScores(termNum);  // Max score for each term, stored in the lexicon
+    for (size_t i = 0; i < termNum; ++i) {
+        maxScores[i] = cursors[i].maxScore();
+    }
+    vector<int> order(termNum);  // lists by current docID
+    iota(order.begin(), order.end(), 0);
+    auto byDocId = [&cursors](int a, int b) { return cursors[a].docId() < cursors[b].docId(); };
+    sort(order.begin(), order.end(), byDocId);
+    auto bubble = [&](size_t i) {  // puts order[i] back in docID order after it moved forward
+        for (; i + 1 < termNum && byDocId(order[i + 1], order[i]); ++i) {
+            swap(order[i], order[i + 1]);
+        }
+    };
+    vector<double> termScores(termNum);  // contribution of every term to the current pivot
 
-                // If any docID is greater than furthestDocID, update furthestDocID
-                if (currentDocIDs[i] > furthestDocID) {
-                    furthestDocID = currentDocIDs[i];  // Update to the new maximum docID
-                    allMatch = false;  // The terms don't match at this docID
-                    break;  // Stop the current round of checking since docIDs don't match yet
+    while (true) {
+        // Step 1: Find the pivot with the list bounds, as WAND does
+        bool full = topKHeap.size() == NUM_TOP_CANDIDATE;
+        double boundSum = 0.0;
+        size_t pivot = termNum;
+        for (size_t i = 0; i < termNum && cursors[order[i]].docId() != (uint32_t)MAX_DOC_ID; ++i) {
+            boundSum += maxScores[order[i]];
+            if (!full || boundSum > topKHeap.top().score) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == termNum) {
+            break;  // No document left can beat the threshold
+        }
+        uint32_t pivotDocId = cursors[order[pivot]].docId();
+        while (pivot + 1 < termNum && cursors[order[pivot + 1]].docId() == pivotDocId) {
+            pivot++;  // lists already at the pivot docID add their score too
+        }
+
+        // Step 2: Check the pivot against the bounds of the chunks that would hold it
+        double blockBound = 0.0;
+        for (size_t i = 0; i <= pivot; ++i) {
+            cursors[order[i]].shallowNextGEQ(pivotDocId);
+            blockBound += cursors[order[i]].shallowMaxScore();
+        }
+
+        if (!full || blockBound > topKHeap.top().score) {
+            if (cursors[order[0]].docId() == pivotDocId) {
+                // Step 3: Score the pivot, replacing chunk bounds by scores until it cannot make the top K
+                fill(termScores.begin(), termScores.end(), 0.0);
+                bool pruned = false;
+                for (size_t i = 0; i <= pivot; ++i) {
+                    PostingCursor &cursor = cursors[order[i]];
+                    if (!pruned) {
+                        termScores[order[i]] = cursor.score();
+                        blockBound -= cursor.shallowMaxScore() - termScores[order[i]];
+                        pruned = full && blockBound <= topKHeap.top().score;
+                    }
+                    cursor.next();
+                }
+                double totalScore = accumulate(termScores.begin(), termScores.end(), 0.0);  // in query order
+                if (!pruned && (!full || totalScore > topKHeap.top().score)) {
+                    topKHeap.emplace(totalScore, pivotDocId);
+                    if (topKHeap.size() > NUM_TOP_CANDIDATE) {
+                        topKHeap.pop();  // Maintain only top-K results
+                    }
+                }
+                for (size_t i = pivot + 1; i-- > 0;) {
+                    bubble(i);
                 }
             }
-
-            if (allMatch) {
-                // All terms match at furthestDocID, so calculate and store the score
-                double totalScore = 0.0;
-                for (int i = 0; i < wordList.size(); ++i) {
-                    totalScore += _getBM25(wordList[i], furthestDocID, freqLists[i][0]);  // Calculate BM25 score
+            else {
+                // Step 4: Move the last list before the pivot docID up to it
+                size_t i = pivot;
+                while (cursors[order[i]].docId() == pivotDocId) {
+                    i--;
                 }
-                docScoreMap[furthestDocID] = totalScore;  // Store the score in the map
-
-                // Move to the next document for all lists
-                furthestDocID = _nextGEQ(docIDLists[0], furthestDocID + 1);  // Get the next docID for the first list
+                cursors[order[i]].nextGEQ(pivotDocId);
+                bubble(i);
             }
         }
-
-        // Retrieve the top-k results
-        _getMapTopK(docScoreMap, NUM_TOP_RESULT);  // Rank and retrieve the top K results
+        else {
+            // Step 5: Nothing before the end of these chunks, nor before the next list, can beat the threshold
+            uint32_t nextDocId = MAX_DOC_ID;
+            size_t maxList = 0;
+            for (size_t i = 0; i <= pivot; ++i) {
+                nextDocId = min(nextDocId, cursors[order[i]].shallowLastDocId());
+                if (maxScores[order[i]] > maxScores[order[maxList]]) {
+                    maxList = i;
+                }
+            }
+            nextDocId = (nextDocId == (uint32_t)MAX_DOC_ID) ? nextDocId : nextDocId + 1;
+            if (pivot + 1 < termNum) {
+                nextDocId = min(nextDocId, cursors[order[pivot + 1]].docId());
+            }
+            nextDocId = max(nextDocId, pivotDocId + 1);
+            cursors[order[maxList]].nextGEQ(nextDocId);
+            bubble(maxList);
+        }
     }
 
-    else if (queryMode == DISJUNCTIVE) {
-        // Disjunctive (OR) query processing
-        _maxScoreTopK(wordList, docIDLists, freqLists);
-    }
+    // Output top-K results
+    _outputTopKResults(topKHeap);
 }
 
 
-void QueryProcessor::_maxScoreTopK(const vector<string>& wordList,
-                                   const vector<vector<uint32_t>>& docIDLists,
-                                   const vector<vector<uint32_t>>& freqLists) {
+// Block-Max MaxScore: essential and non-essential lists as in MaxScore, plus the chunk bounds of the skip
+// directories. Before a candidate is scored, the bounds of the chunks of every list around it are added up;
+// when they cannot beat the threshold, no document up to the end of the shortest of these chunks can, and the
+// essential lists jump past it without decoding. Non-essential lists are probed only while the candidate's
+// score plus their chunk bounds can still beat the threshold. No pivot selection, so long queries stay cheap.
+void QueryProcessor::_blockMaxMaxScoreTopK(vector<PostingCursor>& cursors) {
     priority_queue<DocScoreEntry> topKHeap;  // Priority queue to store top-K scores
-    vector<double> maxScores(wordList.size());  // Max score for each term
-    double topKThreshold = 0.0;  // Threshold for pruning
+    size_t termNum = cursors.size();
+
+    // Step 1: Order the lists by score bound, stored in the lexicon, and sum the bounds of every prefix
+    vector<int> order(termNum);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&cursors](int a, int b) {
+        return cursors[a].maxScore() < cursors[b].maxScore();
+    });
+    vector<double> boundSums(termNum);  // bounds of the lists order[0..i]
+    for (size_t i = 0; i < termNum; ++i) {
+        boundSums[i] = (i ? boundSums[i - 1] : 0.0) + cursors[order[i]].maxScore();
+    }
+    size_t firstEssential = 0;  // order[0..firstEssential) are non-essential
+    vector<double> termScores(termNum);  // contribution of every term to the current candidate
+    vector<double> blockMaxScores(termNum);  // bound of the chunk around the candidate, by position in order
+    double blockBound = 0.0;  // sum of blockMaxScores
+    uint32_t windowEnd = 0;  // last docID of the shortest of these chunks; they hold every candidate up to it
+    bool windowSet = false;
+
+    while (firstEssential < termNum) {
+        // Step 2: The next candidate is the smallest docID of the essential lists
+        uint32_t docId = MAX_DOC_ID;
+        for (size_t i = firstEssential; i < termNum; ++i) {
+            docId = min(docId, cursors[order[i]].docId());
+        }
+        if (docId == (uint32_t)MAX_DOC_ID) {
+            break;  // No more documents to process
+        }
+        bool full = topKHeap.size() == NUM_TOP_CANDIDATE;
+
+        // Step 3: Skip the chunks whose bounds together cannot beat the threshold; the chunk bounds are only
+        // looked up again once the candidate leaves the window they cover
+        if (full) {
+            if (!windowSet || docId > windowEnd) {
+                blockBound = 0.0;
+                windowEnd = MAX_DOC_ID;
+                for (size_t i = 0; i < termNum; ++i) {
+                    PostingCursor &cursor = cursors[order[i]];
+                    cursor.shallowNextGEQ(docId);
+                    blockMaxScores[i] = cursor.shallowMaxScore();
+                    blockBound += blockMaxScores[i];
+                    windowEnd = min(windowEnd, cursor.shallowLastDocId());
+                }
+                windowSet = true;
+            }
+            if (blockBound <= topKHeap.top().score) {
+                if (windowEnd == (uint32_t)MAX_DOC_ID) {
+                    break;  // every list is past its last chunk
+                }
+                for (size_t i = firstEssential; i < termNum; ++i) {
+                    cursors[order[i]].nextGEQ(windowEnd + 1);
+                }
+                continue;
+            }
+        }
 
-    // Step 1: Compute max BM25 score for each term
-    for (int i = 0; i < wordList.size(); ++i) {
-        uint32_t maxFreq = 0;
+        // Step 4: Score it in the essential lists, then in the non-essential ones while it can still make the top K
+        fill(termScores.begin(), termScores.end(), 0.0);
+        double score = 0.0;
+        for (size_t i = firstEssential; i < termNum; ++i) {
+            PostingCursor &cursor = cursors[order[i]];
+            if (cursor.docId() == docId) {
+                termScores[order[i]] = cursor.score();
+                score += termScores[order[i]];
+                cursor.next();
+            }
+        }
+        double restBound = 0.0;  // chunk bounds of the non-essential lists not probed yet
+        for (size_t i = 0; full && i < firstEssential; ++i) {
+            restBound += blockMaxScores[i];
+        }
+        bool pruned = false;
+        for (size_t i = firstEssential; i-- > 0;) {
+            if (full && score + restBound <= topKHeap.top().score) {
+                pruned = true;
+                break;
+            }
+            PostingCursor &cursor = cursors[order[i]];
+            if (cursor.nextGEQ(docId) == docId) {
+                termScores[order[i]] = cursor.score();
+                score += termScores[order[i]];
+            }
+            restBound -= full ? blockMaxScores[i] : 0.0;
+        }
+        if (pruned) {
+            continue;
+        }
 
-        // Check if freqLists[i] is non-empty before calculating max element
-        if (!freqLists[i].empty()) {
-            maxFreq = *max_element(freqLists[i].begin(), freqLists[i].end());
-        } else {
-            // Optionally log a warning if freqLists[i] is unexpectedly empty
-            cout << "Warning: freqLists[" << i << "] is empty for term: " << wordList[i] << endl;
+        // Step 5: Insert the score into top-K heap if it exceeds the threshold, summed in query order
+        double totalScore = accumulate(termScores.begin(), termScores.end(), 0.0);
+        if (!full || totalScore > topKHeap.top().score) {
+            topKHeap.emplace(totalScore, docId);
+            if (topKHeap.size() > NUM_TOP_CANDIDATE) {
+                topKHeap.pop();  // Maintain only top-K results
+            }
         }
 
-        // Calculate BM25 for max frequency (defaulting to 0 if freqLists[i] was empty)
-        maxScores[i] = _getBM25(wordList[i], 0, maxFreq);
+        // Step 6: Lists whose bounds cannot reach the threshold together become non-essential
+        if (topKHeap.size() == NUM_TOP_CANDIDATE) {
+            while (firstEssential < termNum && boundSums[firstEssential] <= topKHeap.top().score) {
+                firstEssential++;
+            }
+        }
     }
 
-    // Step 2: Process docIDs by term
-    vector<uint32_t> currentDocIDs(wordList.size(), 0);  // Store current docID for each term
-    vector<size_t> termIndices(wordList.size(), 0);  // Track the position in each docID list
+    // Output top-K results
+    _outputTopKResults(topKHeap);
+}
+
 
-    // While there are still documents to process
+// Every document of the union is scored: the chunk and list bounds are not used, so the top K is right whatever
+// BM25 parameters the index was built with
+void QueryProcessor::_exhaustiveTopK(vector<PostingCursor>& cursors) {
+    priority_queue<DocScoreEntry> topKHeap;  // Priority queue to store top-K scores
     while (true) {
-        // Step 3: Find the smallest docID across all lists
-        uint32_t minDocID = MAX_DOC_ID;
-        for (int i = 0; i < wordList.size(); ++i) {
-            if (termIndices[i] < docIDLists[i].size()) {
-                minDocID = min(minDocID, docIDLists[i][termIndices[i]]);
-            }
+        uint32_t docId = MAX_DOC_ID;
+        for (PostingCursor &cursor : cursors) {
+            docId = min(docId, cursor.docId());
         }
-        if (minDocID == MAX_DOC_ID) {
+        if (docId == (uint32_t)MAX_DOC_ID) {
             break;  // No more documents to process
         }
 
-        // Step 4: Calculate score for this docID across all terms
-        double totalScore = 0.0;
-        for (int i = 0; i < wordList.size(); ++i) {
-            if (termIndices[i] < docIDLists[i].size() && docIDLists[i][termIndices[i]] == minDocID) {
-                totalScore += _getBM25(wordList[i], minDocID, freqLists[i][termIndices[i]]);
-                termIndices[i]++;  // Move to the next docID in this list
+        double totalScore = 0.0;  // summed in query order, as the pruning algorithms do
+        for (PostingCursor &cursor : cursors) {
+            if (cursor.docId() == docId) {
+                totalScore += cursor.score();
+                cursor.next();
             }
         }
-
-        // Step 5: Insert the score into top-K heap if it exceeds the threshold
-        if (topKHeap.size() < NUM_TOP_RESULT || totalScore > topKThreshold) {
-            topKHeap.emplace(totalScore, minDocID);
-            if (topKHeap.size() > NUM_TOP_RESULT) {
+        if (topKHeap.size() < NUM_TOP_CANDIDATE || totalScore > topKHeap.top().score) {
+            topKHeap.emplace(totalScore, docId);
+            if (topKHeap.size() > NUM_TOP_CANDIDATE) {
                 topKHeap.pop();  // Maintain only top-K results
-                topKThreshold = topKHeap.top().score;  // Update top-K threshold
             }
         }
-
-        // Step 6: Early termination if remaining max score cannot beat top-K threshold
-        double maxRemainingScore = accumulate(maxScores.begin(), maxScores.end(), 0.0);
-        if (maxRemainingScore <= topKThreshold) {
-            break;  // Stop processing further as max remaining score can't exceed top-K
-        }
     }
 
-    // Output top-K results
     _outputTopKResults(topKHeap);
 }
 
@@ -737,11 +769,25 @@ void QueryProcessor::_outputTopKResults(priority_queue<DocScoreEntry>& topKHeap)
     reverse(topKResults.begin(), topKResults.end());
 
     // Insert the results into the search result list
+    map<uint32_t, bool> shownCanonical;  // canonical docs already represented in the results
     for (const auto& [docId, score] : topKResults) {
-        if (RETRIEVE_CONTENT) {
-            _searchResultList.insert(docId, score, _readDocContent(docId));
+        // Collapse near-duplicates: keep only the best-scored document of each cluster
+        if (DEDUP_MODE == 1) {
+            uint32_t canonicalId = duplicateDetector.getCanonical(docId);
+            if (shownCanonical.count(canonicalId)) {
+                continue;
+            }
+            shownCanonical[canonicalId] = true;
+            if (_searchResultList.resultList.size() >= NUM_TOP_RESULT) {
+                break;
+            }
+        }
+        string content = _retrieveContent ? _readDocContent(docId) : "";
+        double bm25Score = IMPACT_MODE ? score * pageTable.getImpactScale() : score;
+        if (CORPUS_FORMAT == CORPUS_FORMAT_BEIR) {
+            _searchResultList.insert(docId, bm25Score, content, pageTable.getExternalId(docId));
         } else {
-            _searchResultList.insert(docId, score, "");
+            _searchResultList.insert(docId, bm25Score, content);
         }
     }
 }
@@ -765,6 +811,7 @@ void QueryProcessor::queryLoop() {
         }
         string queryModeStr;
         int queryMode;
+        int algorithm = DISJUNCTIVE_ALGORITHM;
         cout << "conjunctive (0) or disjunctive (1)>>";
         getline(cin, queryModeStr);   // Get query type
 
@@ -774,6 +821,12 @@ void QueryProcessor::queryLoop() {
         else if (queryModeStr == "1" || queryModeStr == "disjunctive" || queryModeStr == "or") {
             queryMode = DISJUNCTIVE;
         }
+        else if (queryModeStr == "maxscore" || queryModeStr == "wand" || queryModeStr == "bmw" || queryModeStr == "bmm") {
+            queryMode = DISJUNCTIVE;  // disjunctive, with this algorithm
+            algorithm = queryModeStr == "wand" ? DISJUNCTIVE_WAND
+                      : queryModeStr == "bmw" ? DISJUNCTIVE_BMW
+                      : queryModeStr == "bmm" ? DISJUNCTIVE_BMM : DISJUNCTIVE_MAXSCORE;
+        }
         else {
             cout << "cannot recognize query type" << endl;
             continue;
@@ -788,7 +841,7 @@ void QueryProcessor::queryLoop() {
         }
 
         if (DAAT_FLAG) {
-            _queryDAAT(queryWordList, queryMode);
+            _queryDAAT(queryWordList, queryMode, algorithm);
         }
         else {
             _queryTAAT(queryWordList, queryMode);
@@ -804,7 +857,7 @@ void QueryProcessor::queryLoop() {
 
 
 // For front-end Communication
-string QueryProcessor::processQuery(const string &query, int queryMode) {
+string QueryProcessor::processQuery(const string &query, int queryMode, int algorithm) {
     vector<string> queryWordList = _splitQuery(query);
     ostringstream resultStream;
 
@@ -817,7 +870,7 @@ string QueryProcessor::processQuery(const string &query, int queryMode) {
     // Based on queryMode, perform the appropriate query (CONJUNCTIVE or DISJUNCTIVE)
     if ((queryMode == CONJUNCTIVE) || (queryMode == DISJUNCTIVE)) {
         if (DAAT_FLAG) {
-            _queryDAAT(queryWordList, queryMode);
+            _queryDAAT(queryWordList, queryMode, algorithm);
         }
         else {
             _queryTAAT(queryWordList, queryMode);
@@ -831,4 +884,78 @@ string QueryProcessor::processQuery(const string &query, int queryMode) {
     // Print results to the result stream
     _searchResultList.printToServer(resultStream);
     return resultStream.str();
+}
+
+// Runs every BEIR query that has judgments in the qrels split (disjunctive BM25) and writes
+// a TREC run file plus the qrels in the 4-column layout read by trec_eval.py
+void QueryProcessor::runBeirQueries() {
+    vector<pair<string, string>> queries;
+    map<string, map<string, int>> qrels;
+    BeirReader::loadQueries(BEIR_QUERIES_PATH, queries);
+    BeirReader::loadQrels(BEIR_QRELS_PATH, qrels);
+
+    ofstream runFile(BEIR_RUN_PATH);
+    ofstream qrelsFile(BEIR_TREC_QRELS_PATH);
+    if (!runFile.is_open() || !qrelsFile.is_open()) {
+        cerr << "Error opening output file: " << BEIR_RUN_PATH << " or " << BEIR_TREC_QRELS_PATH << endl;
+        return;
+    }
+    for (const auto& [queryId, judgments] : qrels) {
+        for (const auto& [corpusId, relevance] : judgments) {
+            qrelsFile << queryId << "\t0\t" << corpusId << "\t" << relevance << endl;
+        }
+    }
+
+    bool retrieveContent = _retrieveContent;
+    _retrieveContent = false;  // the run file only needs IDs and scores
+    uint32_t queryCount = 0;
+    double reciprocalRankSum = 0;
+    clock_t run_start = clock();
+
+    for (const auto& [queryId, queryText] : queries) {
+        if (!qrels.count(queryId)) {
+            continue;  // query belongs to another split
+        }
+
+        // The index is lowercased; drop terms that are not in the lexicon
+        string lowered = queryText;
+        transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+        vector<string> queryWordList;
+        for (const string &term : _splitQuery(lowered)) {
+            LexiconItem lexItem;
+            if (lexicon.find(term, lexItem)) {
+                queryWordList.push_back(term);
+            }
+        }
+        queryCount += 1;
+        if (queryWordList.empty()) {
+            continue;
+        }
+
+        if (DAAT_FLAG) {
+            _queryDAAT(queryWordList, DISJUNCTIVE);
+        }
+        else {
+            _queryTAAT(queryWordList, DISJUNCTIVE);
+        }
+
+        int rank = 1;
+        bool relevantFound = false;
+        for (const auto &result : _searchResultList.resultList) {
+            // Reciprocal rank of the first relevant document in the top 10
+            auto judgment = qrels[queryId].find(result.externalId);
+            if (!relevantFound && rank <= 10 && judgment != qrels[queryId].end() && judgment->second > 0) {
+                reciprocalRankSum += 1.0 / rank;
+                relevantFound = true;
+            }
+            runFile << queryId << "\tQ0\t" << result.externalId << "\t" << rank++ << "\t"
+                    << result.score << "\tbm25" << endl;
+        }
+    }
+
+    _retrieveContent = retrieveContent;
+    clock_t run_end = clock();
+    cout << "Ran " << queryCount << " BEIR queries in " << double(run_end - run_start) / 1000000 << " Seconds" << endl;
+    cout << "MRR@10: " << setprecision(4) << (queryCount ? reciprocalRankSum / queryCount : 0) << endl;
+    cout << "Run file: " << BEIR_RUN_PATH << ", qrels: " << BEIR_TREC_QRELS_PATH << endl;
 }
\ No newline at end of file
@@ -0,0 +1,398 @@
+#include "RoaringList.h"
+#include "PostingCodec.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+
+RoaringWriter::RoaringWriter(ostream &out, uint32_t containerNum, uint64_t *typeCount)
+        : _out(out), _begin(out.tellp()), _containerNum(containerNum), _typeCount(typeCount),
+          _words(ROARING_BITMAP_WORDS, 0) {
+    _containerList.reserve(containerNum);
+    _size = sizeof(RoaringHeader) + containerNum * sizeof(RoaringContainer);
+    vector<uint8_t> directory(_size, 0);
+    _out.write(reinterpret_cast<const char *>(directory.data()), directory.size());
+}
+
+
+void RoaringWriter::add(uint32_t docId) {
+    if (docId >> 16 != _key) {
+        _flushContainer();
+        _key = docId >> 16;
+    }
+    if (_containerCardinality == 0 || docId != _lastDocId + 1) {
+        _runNum += 1;
+    }
+    uint16_t low = docId & 0xFFFF;
+    _words[low >> 6] |= 1ULL << (low & 63);
+    _containerCardinality += 1;
+    _lastDocId = docId;
+}
+
+
+// The smallest representation of the current container; a bitmap is 8 KB whatever the cardinality
+void RoaringWriter::_flushContainer() {
+    if (_containerCardinality == 0) {
+        return;
+    }
+    uint16_t type = ROARING_BITMAP;
+    size_t bytes = ROARING_BITMAP_WORDS * sizeof(uint64_t);
+    if (_containerCardinality * sizeof(uint16_t) < bytes) {
+        type = ROARING_ARRAY;
+        bytes = _containerCardinality * sizeof(uint16_t);
+    }
+    if (_runNum * 2 * sizeof(uint16_t) < bytes) {
+        type = ROARING_RUN;
+    }
+    _containerList.push_back({(uint16_t)_key, type, _containerCardinality, _cardinality,
+                              type == ROARING_RUN ? _runNum : 0, _size});
+    if (_typeCount) {
+        _typeCount[type] += 1;
+    }
+
+    if (type == ROARING_BITMAP) {
+        _out.write(reinterpret_cast<const char *>(_words.data()), ROARING_BITMAP_WORDS * sizeof(uint64_t));
+        _size += ROARING_BITMAP_WORDS * sizeof(uint64_t);
+    }
+    else {
+        vector<uint16_t> values;  // array values, or the first and last of every run
+        for (uint32_t low = 0; low < ROARING_BITMAP_WORDS * 64; low++) {
+            if (!(_words[low >> 6] >> (low & 63) & 1)) {
+                continue;
+            }
+            if (type == ROARING_ARRAY || values.empty() || values.back() + 1u != low) {
+                if (type == ROARING_RUN) {
+                    values.push_back(low);
+                }
+                values.push_back(low);
+            }
+            else {
+                values.back() = low;
+            }
+        }
+        values.resize((values.size() + 3) / 4 * 4, 0);  // keep the next bitmap aligned
+        _out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(uint16_t));
+        _size += values.size() * sizeof(uint16_t);
+    }
+    _cardinality += _containerCardinality;
+    fill(_words.begin(), _words.end(), 0);
+    _containerCardinality = 0;
+    _runNum = 0;
+}
+
+
+uint64_t RoaringWriter::finish() {
+    _flushContainer();
+    if (_containerList.size() != _containerNum) {
+        cerr << "Roaring containers: " << _containerList.size() << " written, " << _containerNum << " reserved" << endl;
+        exit(1);
+    }
+    RoaringHeader header = {_containerNum, _cardinality};
+    streampos end = _out.tellp();
+    _out.seekp(_begin);
+    _out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    _out.write(reinterpret_cast<const char *>(_containerList.data()), _containerList.size() * sizeof(RoaringContainer));
+    _out.seekp(end);
+    return _size;
+}
+
+
+bool RoaringSet::open(const uint8_t *data, size_t size) {
+    _data = nullptr;
+    _header = nullptr;
+    _containerList = nullptr;
+    if (reinterpret_cast<uintptr_t>(data) % alignof(uint64_t) != 0 || size < sizeof(RoaringHeader)) {
+        return false;
+    }
+    const auto *header = reinterpret_cast<const RoaringHeader *>(data);
+    if (sizeof(RoaringHeader) + (uint64_t)header->containerNum * sizeof(RoaringContainer) > size) {
+        return false;
+    }
+    const auto *containerList = reinterpret_cast<const RoaringContainer *>(data + sizeof(RoaringHeader));
+    for (uint32_t c = 0; c < header->containerNum; c++) {
+        const RoaringContainer &container = containerList[c];
+        uint64_t bytes = container.type == ROARING_BITMAP ? ROARING_BITMAP_WORDS * sizeof(uint64_t)
+                       : container.type == ROARING_ARRAY ? container.cardinality * sizeof(uint16_t)
+                       : container.runNum * 2 * sizeof(uint16_t);
+        if (container.type > ROARING_RUN || container.offset % 8 != 0 || container.offset + bytes > size) {
+            return false;
+        }
+    }
+    _data = data;
+    _header = header;
+    _containerList = containerList;
+    return true;
+}
+
+
+const uint64_t *RoaringSet::_bitmap(const RoaringContainer &container) const {
+    return reinterpret_cast<const uint64_t *>(_data + container.offset);
+}
+
+
+const uint16_t *RoaringSet::_values(const RoaringContainer &container) const {
+    return reinterpret_cast<const uint16_t *>(_data + container.offset);
+}
+
+
+bool RoaringSet::_contains(const RoaringContainer &container, uint16_t low) const {
+    if (container.type == ROARING_BITMAP) {
+        return (_bitmap(container)[low >> 6] >> (low & 63)) & 1;
+    }
+    const uint16_t *values = _values(container);
+    if (container.type == ROARING_ARRAY) {
+        return binary_search(values, values + container.cardinality, low);
+    }
+    // Last run whose first value is <= low
+    uint32_t lo = 0, hi = container.runNum;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (values[2 * mid] <= low) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo > 0 && low <= values[2 * (lo - 1) + 1];
+}
+
+
+uint32_t RoaringSet::findContainer(uint32_t key, uint32_t from) const {
+    uint32_t num = containerNum();
+    if (from >= num) {
+        return num;
+    }
+    return lower_bound(_containerList + from, _containerList + num, key,
+                       [](const RoaringContainer &container, uint32_t k) { return container.key < k; }) - _containerList;
+}
+
+
+void RoaringSet::intersect(const vector<const RoaringSet *> &setList, vector<uint32_t> &out) {
+    out.clear();
+    if (setList.empty()) {
+        return;
+    }
+    // The smallest set drives; the others are only searched for its keys
+    vector<const RoaringSet *> order = setList;
+    sort(order.begin(), order.end(), [](const RoaringSet *a, const RoaringSet *b) { return a->size() < b->size(); });
+    vector<uint32_t> posList(order.size(), 0);
+    vector<const RoaringContainer *> matchList(order.size());
+    vector<uint64_t> words(ROARING_BITMAP_WORDS);
+
+    const RoaringSet &driver = *order[0];
+    for (uint32_t c = 0; c < driver.containerNum(); c++) {
+        const RoaringContainer &first = driver._containerList[c];
+        matchList[0] = &first;
+        bool found = true;
+        for (size_t k = 1; k < order.size() && found; k++) {
+            posList[k] = order[k]->findContainer(first.key, posList[k]);
+            found = posList[k] < order[k]->containerNum() && order[k]->_containerList[posList[k]].key == first.key;
+            matchList[k] = found ? &order[k]->_containerList[posList[k]] : nullptr;
+        }
+        if (!found) {
+            continue;
+        }
+        uint32_t base = (uint32_t)first.key << 16;
+
+        // Probe from the smallest array or run container when there is one
+        size_t probe = order.size();
+        for (size_t k = 0; k < order.size(); k++) {
+            if (matchList[k]->type != ROARING_BITMAP
+                && (probe == order.size() || matchList[k]->cardinality < matchList[probe]->cardinality)) {
+                probe = k;
+            }
+        }
+
+        if (probe == order.size()) {
+            // All bitmaps: one AND per word, and the popcount tells whether anything is left to extract
+            uint64_t count = 0;
+            const uint64_t *bitmap = order[0]->_bitmap(*matchList[0]);
+            for (uint32_t w = 0; w < ROARING_BITMAP_WORDS; w++) {
+                uint64_t word = bitmap[w];
+                for (size_t k = 1; k < order.size(); k++) {
+                    word &= order[k]->_bitmap(*matchList[k])[w];
+                }
+                words[w] = word;
+                count += __builtin_popcountll(word);
+            }
+            if (count == 0) {
+                continue;
+            }
+            out.reserve(out.size() + count);
+            for (uint32_t w = 0; w < ROARING_BITMAP_WORDS; w++) {
+                for (uint64_t word = words[w]; word; word &= word - 1) {
+                    out.push_back(base | (w << 6) | __builtin_ctzll(word));
+                }
+            }
+            continue;
+        }
+
+        const RoaringContainer &probeContainer = *matchList[probe];
+        const uint16_t *values = order[probe]->_values(probeContainer);
+        auto keep = [&](uint16_t low) {
+            for (size_t k = 0; k < order.size(); k++) {
+                if (k != probe && !order[k]->_contains(*matchList[k], low)) {
+                    return;
+                }
+            }
+            out.push_back(base | low);
+        };
+        if (probeContainer.type == ROARING_ARRAY) {
+            for (uint32_t i = 0; i < probeContainer.cardinality; i++) {
+                keep(values[i]);
+            }
+        }
+        else {
+            for (uint32_t r = 0; r < probeContainer.runNum; r++) {
+                for (uint32_t low = values[2 * r]; low <= values[2 * r + 1]; low++) {
+                    keep(low);
+                }
+            }
+        }
+    }
+}
+
+
+RoaringList::RoaringList(const uint8_t *data, uint64_t listBegin, const SkipDirectory &skips, uint32_t codec,
+                         const uint8_t *containers, size_t size)
+        : _data(data), _listBegin(listBegin), _skips(skips), _codec(codec), _container(0), _pos(0), _runRank(0),
+          _rank(0), _docId(MAX_DOC_ID), _blockIdx(UINT32_MAX), _blockChunkBegin(0), _freqChunk(UINT32_MAX) {
+    if (!containers || !_set.open(containers, size) || _set.containerNum() == 0) {
+        return;
+    }
+    _openContainer(0);
+    _seek(0);  // containers are never empty
+}
+
+
+void RoaringList::_openContainer(uint32_t container) {
+    _container = container;
+    _pos = 0;
+    _runRank = 0;
+}
+
+
+bool RoaringList::_seek(uint32_t low) {
+    const RoaringContainer &container = _set._containerList[_container];
+    uint32_t base = (uint32_t)container.key << 16;
+    if (container.type == ROARING_ARRAY) {
+        const uint16_t *values = _set._values(container);
+        _pos = lower_bound(values + _pos, values + container.cardinality, low) - values;
+        if (_pos == container.cardinality) {
+            return false;
+        }
+        _rank = container.rankBase + _pos;
+        _docId = base | values[_pos];
+        return true;
+    }
+    if (container.type == ROARING_RUN) {
+        const uint16_t *runs = _set._values(container);
+        while (_pos < container.runNum && runs[2 * _pos + 1] < low) {
+            _runRank += runs[2 * _pos + 1] - runs[2 * _pos] + 1;
+            _pos += 1;
+        }
+        if (_pos == container.runNum) {
+            return false;
+        }
+        uint32_t value = max<uint32_t>(low, runs[2 * _pos]);
+        _rank = container.rankBase + _runRank + (value - runs[2 * _pos]);
+        _docId = base | value;
+        return true;
+    }
+
+    // Bitmap: whole words are skipped by their popcount
+    const uint64_t *bitmap = _set._bitmap(container);
+    while (_pos < (low >> 6)) {
+        _runRank += __builtin_popcountll(bitmap[_pos]);
+        _pos += 1;
+    }
+    uint64_t word = bitmap[_pos] & (~0ULL << (low & 63));
+    while (word == 0) {
+        _runRank += __builtin_popcountll(bitmap[_pos]);
+        _pos += 1;
+        if (_pos == ROARING_BITMAP_WORDS) {
+            return false;
+        }
+        word = bitmap[_pos];
+    }
+    uint32_t bit = __builtin_ctzll(word);
+    _rank = container.rankBase + _runRank + __builtin_popcountll(bitmap[_pos] & ((1ULL << bit) - 1));
+    _docId = base | (_pos << 6) | bit;
+    return true;
+}
+
+
+uint32_t RoaringList::nextGEQ(uint32_t target) {
+    if (target <= _docId || _docId == (uint32_t)MAX_DOC_ID) {
+        return _docId;
+    }
+    uint32_t low = target & 0xFFFF;
+    if ((target >> 16) != _set._containerList[_container].key) {
+        uint32_t container = _set.findContainer(target >> 16, _container + 1);
+        if (container == _set.containerNum()) {
+            _docId = MAX_DOC_ID;
+            return _docId;
+        }
+        _openContainer(container);
+        low = (_set._containerList[container].key == (target >> 16)) ? low : 0;
+    }
+    while (!_seek(low)) {
+        if (_container + 1 == _set.containerNum()) {
+            _docId = MAX_DOC_ID;
+            return _docId;
+        }
+        _openContainer(_container + 1);
+        low = 0;
+    }
+    return _docId;
+}
+
+
+uint32_t RoaringList::next() {
+    return _docId == (uint32_t)MAX_DOC_ID ? _docId : nextGEQ(_docId + 1);
+}
+
+
+// Frequency chunk offsets and sizes of one block, from its metadata
+void RoaringList::_readBlock(uint32_t blockIdx) {
+    const SkipEntry &entry = _skips.blockList[blockIdx];
+    uint32_t offset = entry.offset - _listBegin;
+    uint32_t metadataSize;
+    memcpy(&metadataSize, _data + offset, sizeof(uint32_t));
+    const uint8_t *meta = _data + offset + sizeof(uint32_t);
+    uint32_t dataPos = offset + 4 + 12 * metadataSize;
+
+    _freqOffsetList.resize(metadataSize);
+    _freqSizeList.resize(metadataSize);
+    for (uint32_t i = 0; i < metadataSize; i++) {
+        uint32_t docIdSize;
+        memcpy(&docIdSize, meta + 4 * (metadataSize + i), sizeof(uint32_t));
+        memcpy(&_freqSizeList[i], meta + 4 * (2 * metadataSize + i), sizeof(uint32_t));
+        _freqOffsetList[i] = dataPos + docIdSize;
+        dataPos += docIdSize + _freqSizeList[i];
+    }
+    _blockIdx = blockIdx;
+    _blockChunkBegin = entry.chunkPos - _skips.blockList[0].chunkPos;
+}
+
+
+// Every chunk but the last holds POSTINGS_PER_CHUNK postings, so the rank gives the chunk and the position in it
+uint32_t RoaringList::freq() {
+    uint32_t chunk = _rank / POSTINGS_PER_CHUNK;
+    if (chunk != _freqChunk) {
+        uint32_t blockIdx = _skips.blockOfChunk(chunk);
+        if (blockIdx != _blockIdx) {
+            _readBlock(blockIdx);
+        }
+        uint32_t i = chunk - _blockChunkBegin;
+        _freqList.assign(POSTINGS_PER_CHUNK, 1);  // an empty chunk is all ones
+        if (_freqSizeList[i] > 0) {
+            _freqList.resize(max<size_t>(_freqSizeList[i], POSTINGS_PER_CHUNK));
+            decodeChunk(freqCodec(_codec), _data + _freqOffsetList[i], _freqSizeList[i], _freqList.data());
+        }
+        _freqChunk = chunk;
+    }
+    return _freqList[_rank % POSTINGS_PER_CHUNK];
+}
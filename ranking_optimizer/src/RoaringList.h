@@ -0,0 +1,135 @@
+#ifndef SEARCHSYSTEM_ROARINGLIST_H
+#define SEARCHSYSTEM_ROARINGLIST_H
+
+#include "config.h"
+#include "SkipDirectory.h"
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+using namespace std;
+
+
+// Roaring-style docID containers of the dense lists (ROARING_MODE). The docID space is cut into ranges of
+// 65536 and every non-empty range of a list gets one container, the smallest of: a bitmap of 1024 words,
+// a sorted array of the low 16 bits, or runs of consecutive docIDs. The containers follow the list's
+// blocks in the index; the blocks keep the docIDs and frequencies for every other query path, and the rank
+// of a docID in the containers is its posting index in the blocks.
+//
+// Layout, 8-byte aligned: [RoaringHeader][RoaringContainer * containerNum][container data]
+#define ROARING_BITMAP 0  // 1024 uint64 words, bit i set for low bits i
+#define ROARING_ARRAY 1  // cardinality uint16 low bits, increasing
+#define ROARING_RUN 2  // runNum (first, last) uint16 pairs, last inclusive
+#define ROARING_BITMAP_WORDS 1024
+
+struct RoaringHeader {
+    uint32_t containerNum;
+    uint32_t cardinality;  // docIDs of the list
+};
+
+struct RoaringContainer {
+    uint16_t key;  // high 16 bits of the container's docIDs
+    uint16_t type;  // ROARING_*
+    uint32_t cardinality;
+    uint32_t rankBase;  // docIDs of the list in the containers before this one
+    uint32_t runNum;  // ROARING_RUN only
+    uint64_t offset;  // of the container data, from the first byte of the header
+};
+
+// One dense list in the index directory of containers, sorted by listBegin
+struct DenseListEntry {
+    uint64_t listBegin;  // LexiconItem::beginPos of the list
+    uint64_t offset;  // absolute index file offset of the list's RoaringHeader, up to LexiconItem::endPos
+};
+
+// Streams the containers of an increasing docID list to a file. Only the current container is held, as a bitmap
+// whatever its type, and its data is written once the next key starts: memory does not grow with the list.
+// The header and the container directory come first, so their room is reserved for containerNum containers
+// and they are written by finish(). typeCount, when given, is incremented for the type of every container.
+class RoaringWriter {
+private:
+    ostream &_out;
+    streampos _begin;  // file position of the RoaringHeader
+    uint32_t _containerNum;
+    uint64_t *_typeCount;
+    vector<RoaringContainer> _containerList;
+    uint64_t _size;  // bytes written from _begin
+    uint32_t _cardinality = 0;  // docIDs of the list so far
+
+    uint32_t _key = UINT32_MAX;  // the current container
+    vector<uint64_t> _words;  // its docIDs, ROARING_BITMAP_WORDS words
+    uint32_t _containerCardinality = 0;
+    uint32_t _runNum = 0;
+    uint32_t _lastDocId = 0;
+
+    void _flushContainer();
+
+public:
+    RoaringWriter(ostream &out, uint32_t containerNum, uint64_t *typeCount = nullptr);
+    void add(uint32_t docId);  // docIDs must increase
+    uint64_t finish();  // writes the header and the directory, returns the size of the containers
+};
+
+
+// Read-only view of the containers of one list
+class RoaringSet {
+private:
+    const uint8_t *_data = nullptr;
+    const RoaringHeader *_header = nullptr;
+    const RoaringContainer *_containerList = nullptr;
+
+    const uint64_t *_bitmap(const RoaringContainer &container) const;
+    const uint16_t *_values(const RoaringContainer &container) const;  // array values or run pairs
+    bool _contains(const RoaringContainer &container, uint16_t low) const;
+    friend class RoaringList;
+
+public:
+    bool open(const uint8_t *data, size_t size);  // data must be 8-byte aligned
+    uint32_t size() const { return _header ? _header->cardinality : 0; }
+    uint32_t containerNum() const { return _header ? _header->containerNum : 0; }
+    uint32_t findContainer(uint32_t key, uint32_t from = 0) const;  // first container from `from` with a key >= key
+
+    // Docs in all sets, increasing. Matching bitmap containers are combined with a word-parallel AND and
+    // popcount; otherwise the values of the smallest array or run container are probed in the others.
+    static void intersect(const vector<const RoaringSet *> &setList, vector<uint32_t> &out);
+};
+
+
+// Forward cursor over one dense list, with the interface of PostingCursor: docIDs come from the containers,
+// and frequencies from the list's blocks at the rank of the docID, read only for the chunks asked for
+class RoaringList {
+private:
+    RoaringSet _set;
+    const uint8_t *_data;  // first byte of the term's postings
+    uint64_t _listBegin;  // index file offset of _data
+    SkipDirectory _skips;
+    uint32_t _codec;  // the list's codec, for its frequency chunks
+
+    uint32_t _container;
+    uint32_t _pos;  // array index, run index or bitmap word of the current docID
+    uint32_t _runRank;  // ROARING_RUN: values in the runs before _pos; ROARING_BITMAP: set bits in the words before _pos
+    uint32_t _rank;  // index of the current docID in the list
+    uint32_t _docId;
+
+    uint32_t _blockIdx;  // block whose frequency chunk offsets are loaded below
+    uint32_t _blockChunkBegin;
+    vector<uint32_t> _freqOffsetList, _freqSizeList;
+    uint32_t _freqChunk;  // chunk decoded in _freqList
+    vector<uint32_t> _freqList;
+
+    void _openContainer(uint32_t container);
+    bool _seek(uint32_t low);  // first docID >= low in the current container, from the current one
+    void _readBlock(uint32_t blockIdx);
+
+public:
+    RoaringList(const uint8_t *data, uint64_t listBegin, const SkipDirectory &skips, uint32_t codec,
+                const uint8_t *containers, size_t size);
+
+    const RoaringSet &set() const { return _set; }
+    uint32_t docId() const { return _docId; }  // MAX_DOC_ID once the list is exhausted
+    uint32_t next();
+    uint32_t nextGEQ(uint32_t target);  // moves to the first docID >= target and returns it
+    uint32_t freq();  // frequency of the current docID
+};
+
+#endif //SEARCHSYSTEM_ROARINGLIST_H
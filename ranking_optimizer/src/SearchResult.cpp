@@ -29,6 +29,13 @@ void SearchResultList::insert(uint32_t docID, double score, string content) {
 }
 
 
+void SearchResultList::insert(uint32_t docID, double score, string content, string externalId) {
+    SearchResult resultItem(docID, score, content);
+    resultItem.externalId = externalId;
+    resultList.push_back(resultItem);
+}
+
+
 void SearchResultList::clear() {
     resultList.clear();
 }
@@ -39,9 +46,10 @@ void SearchResultList::printToConsole() {
     // Set the precision for score output to 4 decimal places
     cout << fixed << setprecision(4);
     // Iterate through the results in order of insertion
-    for (int i = 0; i < resultList.size(); i++) {
+    for (size_t i = 0; i < resultList.size(); i++) {
         cout << setw(2) << (i + 1) << ": "  // Output the rank
-             << resultList[i].score << " " << resultList[i].docId << endl;
+             << resultList[i].score << " "
+             << (resultList[i].externalId.empty() ? to_string(resultList[i].docId) : resultList[i].externalId) << endl;
         cout << resultList[i].content << endl;  // Output the content
         cout << endl;
     }
@@ -55,7 +63,8 @@ void SearchResultList::printToServer(ostream &out) {
         // Replace commas in content with spaces to avoid format issues
         replace(result.content.begin(), result.content.end(), ',', ' ');
         // Output the result to the server stream
-        out << "DocId: " << result.docId << ", Score: " << result.score
+        out << "DocId: " << (result.externalId.empty() ? to_string(result.docId) : result.externalId)
+            << ", Score: " << result.score
             << ", Content: " << result.content << endl;
     }
 }
\ No newline at end of file
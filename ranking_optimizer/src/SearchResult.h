@@ -13,6 +13,7 @@ public:
     uint32_t docId;
     double score;
     string content;
+    string externalId;  // dataset document ID, empty when it equals docId
     SearchResult();
     SearchResult(uint32_t, double, string);
     ~SearchResult();
@@ -22,6 +23,7 @@ class SearchResultList {
 public:
     vector<SearchResult> resultList;
     void insert(uint32_t, double, string);
+    void insert(uint32_t, double, string, string);  // with the external document ID
     void clear();
     void printToConsole();
     void printToServer(ostream &out = cout);  // overload, for front-end
@@ -0,0 +1,23 @@
+#include "SkipDirectory.h"
+#include <algorithm>
+using namespace std;
+
+
+uint32_t SkipDirectory::findBlock(uint32_t target) const {
+    const SkipEntry *it = lower_bound(blockList, blockList + blockNum, target,
+                                      [](const SkipEntry &entry, uint32_t docId) { return entry.lastDocId < docId; });
+    return it - blockList;
+}
+
+
+uint32_t SkipDirectory::findChunk(uint32_t target, uint32_t from) const {
+    return lower_bound(chunkLastList + from, chunkLastList + chunkNum, target) - chunkLastList;
+}
+
+
+uint32_t SkipDirectory::blockOfChunk(uint32_t chunk) const {
+    uint32_t chunkPos = blockList[0].chunkPos + chunk;
+    const SkipEntry *it = upper_bound(blockList, blockList + blockNum, chunkPos,
+                                      [](uint32_t pos, const SkipEntry &entry) { return pos < entry.chunkPos; });
+    return (it - blockList) - 1;
+}
@@ -0,0 +1,39 @@
+#ifndef SEARCHSYSTEM_SKIPDIRECTORY_H
+#define SEARCHSYSTEM_SKIPDIRECTORY_H
+
+#include "config.h"
+#include <cstdint>
+using namespace std;
+
+
+// One BLOCK_SIZE block of a posting list, as written by Lexicon::_writeBlocks
+struct SkipEntry {
+    uint64_t offset;  // absolute index file offset of the block (its metadata size field)
+    uint32_t firstDocId;
+    uint32_t lastDocId;
+    uint32_t chunkPos;  // index of the block's first chunk in the chunk last docID array of all terms
+    uint32_t chunkNum;
+};
+
+
+// Skip directory of one term, kept in memory by the lexicon: the bounds of every block and the last
+// docID of every chunk, so a cursor finds the block and chunk holding a docID without touching the index
+class SkipDirectory {
+public:
+    const SkipEntry *blockList = nullptr;
+    uint32_t blockNum = 0;
+    const uint32_t *chunkLastList = nullptr;  // last docID of every chunk, increasing
+    uint32_t chunkNum = 0;
+    const uint8_t *chunkMaxList = nullptr;  // score upper bound of every chunk, in impact levels
+    uint32_t maxLevel = 0;  // score upper bound of the whole list, in impact levels, from the lexicon
+    double scoreScale = 0;  // score of one impact level, in the units of PostingCursor::score
+
+    double chunkMaxScore(uint32_t chunk) const { return chunkMaxList[chunk] * scoreScale; }
+    double maxScore() const { return maxLevel * scoreScale; }
+
+    uint32_t findBlock(uint32_t target) const;  // first block whose last docID is >= target, blockNum if none
+    uint32_t findChunk(uint32_t target, uint32_t from = 0) const;  // first chunk from `from` whose last docID is >= target, chunkNum if none
+    uint32_t blockOfChunk(uint32_t chunk) const;  // block holding the given chunk of the term
+};
+
+#endif //SEARCHSYSTEM_SKIPDIRECTORY_H
@@ -0,0 +1,295 @@
+#include "TermDictionary.h"
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+
+// Default constructor and destructor for LexiconItem
+LexiconItem::LexiconItem() = default;
+LexiconItem::~LexiconItem() = default;
+
+
+// Update the LexiconItem fields
+void LexiconItem::update(uint64_t beginPos, uint64_t endPos, uint32_t docNum, uint32_t blockNum, uint32_t codec, uint64_t skipPos, uint32_t maxLevel) {
+    this->beginPos = beginPos;
+    this->endPos = endPos;
+    this->docNum = docNum;
+    this->blockNum = blockNum;
+    this->codec = codec;
+    this->skipPos = skipPos;
+    this->maxLevel = maxLevel;
+}
+
+
+static inline void appendVarbyte(uint64_t value, vector<uint8_t> &out) {
+    while (value > 0x7F) {
+        out.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(value);
+}
+
+
+static inline const uint8_t *readVarbyte(const uint8_t *in, uint32_t &value) {
+    value = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t byte = *in++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return in;
+        }
+    }
+}
+
+
+static inline uint32_t bitWidth(uint64_t value) {
+    return value ? 64 - __builtin_clzll(value) : 0;
+}
+
+
+// Fields never cross more than two words; the record array has a spare word at the end
+static inline uint64_t readBits(const uint64_t *words, uint64_t bitPos, uint32_t width) {
+    if (width == 0) {
+        return 0;
+    }
+    uint64_t word = bitPos >> 6;
+    uint32_t shift = bitPos & 63;
+    uint64_t value = words[word] >> shift;
+    if (shift + width > 64) {
+        value |= words[word + 1] << (64 - shift);
+    }
+    return width == 64 ? value : value & ((1ULL << width) - 1);
+}
+
+
+static inline void writeBits(uint64_t *words, uint64_t bitPos, uint32_t width, uint64_t value) {
+    if (width == 0) {
+        return;
+    }
+    uint64_t word = bitPos >> 6;
+    uint32_t shift = bitPos & 63;
+    words[word] |= value << shift;
+    if (shift + width > 64) {
+        words[word + 1] |= value >> (64 - shift);
+    }
+}
+
+
+TermDictionary::TermDictionary() = default;
+TermDictionary::~TermDictionary() = default;
+
+
+void TermDictionary::clear() {
+    _header = nullptr;
+    _bucketOffsetList = nullptr;
+    _recordList = nullptr;
+    _termList = nullptr;
+    _imageSize = 0;
+    _image.clear();
+    _pendingTerms.clear();
+    _pendingBuckets.clear();
+    _pendingItems.clear();
+    _lastTerm.clear();
+}
+
+
+// Adds the next term; terms must come in strictly increasing order
+bool TermDictionary::append(const string &term, const LexiconItem &item) {
+    if (!_pendingItems.empty() && string_view(term) <= string_view(_lastTerm)) {
+        cout << "Unexpected: term \"" << term << "\" out of order in the merged index, skipped" << endl;
+        return false;
+    }
+    if (_pendingItems.size() % LEXICON_BUCKET_SIZE == 0) {
+        _pendingBuckets.push_back(_pendingTerms.size());  // bucket head, stored whole
+        appendVarbyte(term.size(), _pendingTerms);
+        _pendingTerms.insert(_pendingTerms.end(), term.begin(), term.end());
+    }
+    else {
+        size_t shared = 0;
+        size_t maxShared = min(term.size(), _lastTerm.size());
+        while (shared < maxShared && term[shared] == _lastTerm[shared]) {
+            shared += 1;
+        }
+        appendVarbyte(shared, _pendingTerms);
+        appendVarbyte(term.size() - shared, _pendingTerms);
+        _pendingTerms.insert(_pendingTerms.end(), term.begin() + shared, term.end());
+    }
+    _pendingItems.push_back(item);
+    _lastTerm = term;
+    return true;
+}
+
+
+// Packs the appended terms into the image; the dictionary is readable afterwards
+void TermDictionary::finish(uint64_t postingsEnd) {
+    DictionaryHeader header;
+    memset(&header, 0, sizeof(header));
+    header.termNum = _pendingItems.size();
+    header.bucketNum = _pendingBuckets.size();
+    header.postingsEnd = postingsEnd;
+    header.termBytes = _pendingTerms.size();
+    header.bucketSize = LEXICON_BUCKET_SIZE;
+
+    uint64_t maxList[FIELD_NUM] = {0};
+    for (const LexiconItem &item : _pendingItems) {
+        maxList[0] = max(maxList[0], item.beginPos);
+        maxList[1] = max<uint64_t>(maxList[1], item.docNum);
+        maxList[2] = max<uint64_t>(maxList[2], item.blockNum);
+        maxList[3] = max<uint64_t>(maxList[3], item.codec);
+        maxList[4] = max(maxList[4], item.skipPos);
+        maxList[5] = max<uint64_t>(maxList[5], item.maxLevel);
+    }
+    uint32_t recordBits = 0;
+    for (uint32_t field = 0; field < FIELD_NUM; field++) {
+        header.fieldWidthList[field] = bitWidth(maxList[field]);
+        recordBits += header.fieldWidthList[field];
+    }
+    header.recordBits = recordBits;
+    header.recordWordNum = (header.termNum * recordBits + 63) / 64 + 1;
+
+    uint64_t bucketBegin = sizeof(DictionaryHeader) / sizeof(uint64_t);
+    uint64_t recordBegin = bucketBegin + header.bucketNum;
+    uint64_t termBegin = recordBegin + header.recordWordNum;
+    _image.assign(termBegin + (header.termBytes + 7) / 8, 0);
+    memcpy(_image.data(), &header, sizeof(header));
+    memcpy(&_image[bucketBegin], _pendingBuckets.data(), header.bucketNum * sizeof(uint64_t));
+    memcpy(&_image[termBegin], _pendingTerms.data(), header.termBytes);
+
+    uint64_t bitPos = 0;
+    for (const LexiconItem &item : _pendingItems) {
+        uint64_t fieldList[FIELD_NUM] = {item.beginPos, item.docNum, item.blockNum, item.codec, item.skipPos, item.maxLevel};
+        for (uint32_t field = 0; field < FIELD_NUM; field++) {
+            writeBits(&_image[recordBegin], bitPos, header.fieldWidthList[field], fieldList[field]);
+            bitPos += header.fieldWidthList[field];
+        }
+    }
+
+    _pendingTerms = vector<uint8_t>();
+    _pendingBuckets = vector<uint64_t>();
+    _pendingItems = vector<LexiconItem>();
+    _lastTerm.clear();
+    _setImage(reinterpret_cast<const uint8_t *>(_image.data()), _image.size() * sizeof(uint64_t));
+}
+
+
+bool TermDictionary::open(const uint8_t *image, size_t size) {
+    clear();
+    if (reinterpret_cast<uintptr_t>(image) % alignof(uint64_t) != 0) {
+        return false;  // the records are read as 64-bit words
+    }
+    return _setImage(image, size);
+}
+
+
+// Points the readers into an image, after checking that its parts fit in size bytes
+bool TermDictionary::_setImage(const uint8_t *image, size_t size) {
+    const auto *header = reinterpret_cast<const DictionaryHeader *>(image);
+    if (size < sizeof(DictionaryHeader)) {
+        return false;
+    }
+    uint64_t expected = sizeof(DictionaryHeader) + (header->bucketNum + header->recordWordNum) * sizeof(uint64_t) + header->termBytes;
+    if (header->bucketSize == 0 || header->bucketNum != (header->termNum + header->bucketSize - 1) / header->bucketSize
+        || header->recordWordNum < (header->termNum * header->recordBits + 63) / 64 + 1 || expected > size) {
+        return false;
+    }
+    _header = header;
+    _bucketOffsetList = reinterpret_cast<const uint64_t *>(image + sizeof(DictionaryHeader));
+    _recordList = _bucketOffsetList + header->bucketNum;
+    _termList = reinterpret_cast<const uint8_t *>(_recordList + header->recordWordNum);
+    _imageSize = size;
+    return true;
+}
+
+
+string_view TermDictionary::_bucketHead(uint64_t bucket) const {
+    uint32_t length;
+    const uint8_t *pos = readVarbyte(_termList + _bucketOffsetList[bucket], length);
+    return {reinterpret_cast<const char *>(pos), length};
+}
+
+
+uint64_t TermDictionary::_readField(uint64_t termIdx, uint32_t field) const {
+    uint64_t bitPos = termIdx * _header->recordBits;
+    for (uint32_t i = 0; i < field; i++) {
+        bitPos += _header->fieldWidthList[i];
+    }
+    return readBits(_recordList, bitPos, _header->fieldWidthList[field]);
+}
+
+
+// Binary search on the bucket heads, then a scan of one bucket
+bool TermDictionary::find(string_view term, uint64_t &termIdx) const {
+    if (!_header || _header->bucketNum == 0) {
+        return false;
+    }
+    uint64_t low = 0, high = _header->bucketNum;  // first bucket whose head is larger than the term
+    while (low < high) {
+        uint64_t mid = (low + high) / 2;
+        if (_bucketHead(mid) <= term) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    if (low == 0) {
+        return false;
+    }
+    uint64_t bucket = low - 1;
+    string_view head = _bucketHead(bucket);
+    if (head == term) {
+        termIdx = bucket * _header->bucketSize;
+        return true;
+    }
+
+    string buffer(head);  // each term is rebuilt from the previous one
+    const uint8_t *pos = reinterpret_cast<const uint8_t *>(head.data() + head.size());
+    uint64_t last = min(_header->termNum, (bucket + 1) * _header->bucketSize);
+    for (uint64_t i = bucket * _header->bucketSize + 1; i < last; i++) {
+        uint32_t shared, suffix;
+        pos = readVarbyte(pos, shared);
+        pos = readVarbyte(pos, suffix);
+        buffer.resize(shared);
+        buffer.append(reinterpret_cast<const char *>(pos), suffix);
+        pos += suffix;
+        int order = string_view(buffer).compare(term);
+        if (order == 0) {
+            termIdx = i;
+            return true;
+        }
+        if (order > 0) {
+            break;
+        }
+    }
+    return false;
+}
+
+
+string TermDictionary::term(uint64_t termIdx) const {
+    uint64_t bucket = termIdx / _header->bucketSize;
+    string_view head = _bucketHead(bucket);
+    string buffer(head);
+    const uint8_t *pos = reinterpret_cast<const uint8_t *>(head.data() + head.size());
+    for (uint64_t i = bucket * _header->bucketSize + 1; i <= termIdx; i++) {
+        uint32_t shared, suffix;
+        pos = readVarbyte(pos, shared);
+        pos = readVarbyte(pos, suffix);
+        buffer.resize(shared);
+        buffer.append(reinterpret_cast<const char *>(pos), suffix);
+        pos += suffix;
+    }
+    return buffer;
+}
+
+
+LexiconItem TermDictionary::item(uint64_t termIdx) const {
+    LexiconItem item;
+    item.beginPos = _readField(termIdx, 0);
+    item.endPos = termIdx + 1 < _header->termNum ? _readField(termIdx + 1, 0) : _header->postingsEnd;
+    item.docNum = _readField(termIdx, 1);
+    item.blockNum = _readField(termIdx, 2);
+    item.codec = _readField(termIdx, 3);
+    item.skipPos = _readField(termIdx, 4);
+    item.maxLevel = _readField(termIdx, 5);
+    return item;
+}
@@ -0,0 +1,91 @@
+#ifndef SEARCHSYSTEM_TERMDICTIONARY_H
+#define SEARCHSYSTEM_TERMDICTIONARY_H
+
+#include "config.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+
+// Metadata of one term, as stored in the dictionary
+class LexiconItem {
+public:
+    uint64_t beginPos{}; // begin offset, absolute in the index file
+    uint64_t endPos{};   // end offset
+    uint32_t docNum{};
+    uint32_t blockNum{};
+    uint32_t codec{};  // CODEC_* of the docID chunks, see PostingCodec.h
+    uint64_t skipPos{};  // first SkipEntry of the term in the skip directory
+    uint32_t maxLevel{};  // score upper bound of the whole list, in impact levels (its largest chunk bound)
+
+    LexiconItem();
+    ~LexiconItem();
+    void update(uint64_t, uint64_t, uint32_t, uint32_t, uint32_t, uint64_t, uint32_t);
+};
+
+
+// Sorted vocabulary with front coding, the in-memory and on-disk form of the lexicon.
+//
+// The dictionary is one contiguous image, 8-byte aligned, stored as is in the lexicon file:
+// [DictionaryHeader][bucket offsets, uint64 each][term records, bit-packed][front-coded buckets]
+// Terms are grouped in buckets of LEXICON_BUCKET_SIZE. The first term of a bucket is stored whole
+// ([length][bytes]), the others as [shared prefix length][suffix length][suffix bytes], all lengths
+// varbyte. Lookups binary-search the bucket heads, then decode one bucket.
+// Every term has a fixed-width record of bit-packed fields (beginPos, docNum, blockNum, codec, skipPos, maxLevel),
+// each field as wide as its largest value; endPos is the next term's beginPos.
+class TermDictionary {
+private:
+    static const uint32_t FIELD_NUM = 6;
+
+    struct DictionaryHeader {
+        uint64_t termNum;
+        uint64_t bucketNum;
+        uint64_t postingsEnd;  // endPos of the last term
+        uint64_t recordWordNum;  // uint64 words of bit-packed records
+        uint64_t termBytes;  // bytes of front-coded buckets
+        uint32_t bucketSize;
+        uint8_t fieldWidthList[FIELD_NUM];  // bits of beginPos, docNum, blockNum, codec, skipPos, maxLevel
+        uint8_t recordBits;
+        uint8_t reserved[1];
+    };
+
+    // Image being read
+    const DictionaryHeader *_header = nullptr;
+    const uint64_t *_bucketOffsetList = nullptr;
+    const uint64_t *_recordList = nullptr;
+    const uint8_t *_termList = nullptr;
+    size_t _imageSize = 0;
+    vector<uint64_t> _image;  // image built by finish(); a loaded image is read in place
+
+    // Terms appended by the builder, until finish()
+    vector<uint8_t> _pendingTerms;
+    vector<uint64_t> _pendingBuckets;
+    vector<LexiconItem> _pendingItems;
+    string _lastTerm;
+
+    bool _setImage(const uint8_t *image, size_t size);
+    string_view _bucketHead(uint64_t bucket) const;
+    uint64_t _readField(uint64_t term, uint32_t field) const;
+
+public:
+    TermDictionary();
+    ~TermDictionary();
+
+    // Building: terms come in increasing byte order, as the merged index lists them
+    void clear();
+    bool append(const string &term, const LexiconItem &item);
+    void finish(uint64_t postingsEnd);
+
+    // Reading
+    bool open(const uint8_t *image, size_t size);  // no copy: the image must stay valid, e.g. a mapped file
+    const uint8_t *image() const { return reinterpret_cast<const uint8_t *>(_header); }
+    size_t imageSize() const { return _imageSize; }
+    uint64_t size() const { return _header ? _header->termNum : 0; }
+    bool find(string_view term, uint64_t &termIdx) const;
+    string term(uint64_t termIdx) const;
+    LexiconItem item(uint64_t termIdx) const;
+};
+
+#endif //SEARCHSYSTEM_TERMDICTIONARY_H
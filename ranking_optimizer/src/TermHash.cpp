@@ -0,0 +1,206 @@
+#include "TermHash.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+
+// 64-bit string hash, 8 bytes per step; the level positions and the fingerprint are all derived from it
+static uint64_t hashTerm(string_view term) {
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ (term.size() * 0xff51afd7ed558ccdULL);
+    size_t pos = 0;
+    for (; pos + 8 <= term.size(); pos += 8) {
+        uint64_t word;
+        memcpy(&word, term.data() + pos, 8);
+        hash = mix64(hash ^ word);
+    }
+    if (pos < term.size()) {
+        uint64_t word = 0;
+        memcpy(&word, term.data() + pos, term.size() - pos);
+        hash = mix64(hash ^ word);
+    }
+    return hash;
+}
+
+
+static inline uint64_t levelPos(uint64_t hash, uint64_t level, uint64_t bitNum) {
+    uint64_t levelHash = mix64(hash + (level + 1) * 0x9E3779B97F4A7C15ULL);
+    return (uint64_t)(((unsigned __int128)levelHash * bitNum) >> 64);  // in [0, bitNum) without a division
+}
+
+
+static inline uint32_t fingerprint(uint64_t hash) {
+    return mix64(hash ^ 0xD6E8FEB86659FD93ULL) >> 32;
+}
+
+
+TermHash::TermHash() = default;
+TermHash::~TermHash() = default;
+
+
+void TermHash::clear() {
+    _header = nullptr;
+    _bitList = nullptr;
+    _rankList = nullptr;
+    _slotList = nullptr;
+    _imageSize = 0;
+    _image.clear();
+}
+
+
+bool TermHash::build(const TermDictionary &dictionary) {
+    clear();
+    uint64_t termNum = dictionary.size();
+    vector<uint64_t> hashList(termNum);
+    for (uint64_t i = 0; i < termNum; i++) {
+        hashList[i] = hashTerm(dictionary.term(i));
+    }
+
+    // Place the terms level by level; the ones colliding at a level move on to the next one
+    vector<uint64_t> bitList;  // bits of all levels
+    vector<pair<uint64_t, uint32_t>> placedList;  // global bit and term index of every placed term
+    placedList.reserve(termNum);
+    uint64_t levelBeginList[MAX_LEVELS + 1] = {0};
+    vector<uint32_t> remaining(termNum), next;
+    for (uint64_t i = 0; i < termNum; i++) {
+        remaining[i] = i;
+    }
+    uint64_t levelNum = 0;
+    while (!remaining.empty() && levelNum < MAX_LEVELS) {
+        uint64_t wordNum = max<uint64_t>(1, (uint64_t)ceil(LEXICON_HASH_GAMMA * remaining.size() / 64));
+        uint64_t bitNum = wordNum * 64;
+        vector<uint64_t> seen(wordNum, 0), collided(wordNum, 0);
+        for (uint32_t termIdx : remaining) {
+            uint64_t pos = levelPos(hashList[termIdx], levelNum, bitNum);
+            uint64_t bit = 1ULL << (pos & 63);
+            collided[pos >> 6] |= seen[pos >> 6] & bit;
+            seen[pos >> 6] |= bit;
+        }
+        uint64_t levelBegin = bitList.size();
+        next.clear();
+        for (uint32_t termIdx : remaining) {
+            uint64_t pos = levelPos(hashList[termIdx], levelNum, bitNum);
+            if (collided[pos >> 6] & (1ULL << (pos & 63))) {
+                next.push_back(termIdx);
+            }
+            else {
+                placedList.emplace_back(levelBegin * 64 + pos, termIdx);
+            }
+        }
+        for (uint64_t word = 0; word < wordNum; word++) {
+            bitList.push_back(seen[word] & ~collided[word]);
+        }
+        levelNum += 1;
+        levelBeginList[levelNum] = bitList.size();
+        remaining.swap(next);
+    }
+
+    TermHashHeader header;
+    memset(&header, 0, sizeof(header));
+    header.termNum = termNum;
+    if (!remaining.empty()) {
+        cout << "Unexpected: " << remaining.size() << " terms left after " << MAX_LEVELS
+             << " hash levels, the lexicon uses binary search only" << endl;
+        bitList.clear();
+        placedList.clear();
+        levelNum = 0;
+    }
+    header.levelNum = levelNum;
+    memcpy(header.levelBeginList, levelBeginList, sizeof(levelBeginList));
+    header.rankNum = (bitList.size() + 7) / 8;
+
+    uint64_t bitBegin = sizeof(TermHashHeader) / sizeof(uint64_t);
+    uint64_t rankBegin = bitBegin + bitList.size();
+    uint64_t slotBegin = rankBegin + header.rankNum;
+    _image.assign(slotBegin + (levelNum ? termNum : 0), 0);
+    memcpy(_image.data(), &header, sizeof(header));
+    memcpy(&_image[bitBegin], bitList.data(), bitList.size() * sizeof(uint64_t));
+    uint64_t rank = 0;
+    for (uint64_t word = 0; word < bitList.size(); word++) {
+        if (word % 8 == 0) {
+            _image[rankBegin + word / 8] = rank;
+        }
+        rank += __builtin_popcountll(bitList[word]);
+    }
+    _setImage(reinterpret_cast<const uint8_t *>(_image.data()), _image.size() * sizeof(uint64_t));
+
+    // Each term's slot is the rank of its bit
+    auto *slotList = &_image[slotBegin];
+    for (const auto &[bit, termIdx] : placedList) {
+        uint64_t word = bit >> 6;
+        uint64_t slot = _rankList[word / 8];
+        for (uint64_t w = word & ~7ULL; w < word; w++) {
+            slot += __builtin_popcountll(_bitList[w]);
+        }
+        slot += __builtin_popcountll(_bitList[word] & ((1ULL << (bit & 63)) - 1));
+        slotList[slot] = (uint64_t)fingerprint(hashList[termIdx]) << 32 | termIdx;
+    }
+    return ready();
+}
+
+
+bool TermHash::open(const uint8_t *image, size_t size) {
+    clear();
+    if (reinterpret_cast<uintptr_t>(image) % alignof(uint64_t) != 0) {
+        return false;
+    }
+    return _setImage(image, size);
+}
+
+
+// Points the readers into an image, after checking that its parts fit in size bytes
+bool TermHash::_setImage(const uint8_t *image, size_t size) {
+    const auto *header = reinterpret_cast<const TermHashHeader *>(image);
+    if (size < sizeof(TermHashHeader) || header->levelNum > MAX_LEVELS) {
+        return false;
+    }
+    uint64_t wordNum = header->levelBeginList[header->levelNum];
+    uint64_t slotNum = header->levelNum ? header->termNum : 0;
+    uint64_t expected = sizeof(TermHashHeader) + (wordNum + header->rankNum + slotNum) * sizeof(uint64_t);
+    if (header->rankNum != (wordNum + 7) / 8 || expected > size) {
+        return false;
+    }
+    _header = header;
+    _bitList = reinterpret_cast<const uint64_t *>(image + sizeof(TermHashHeader));
+    _rankList = _bitList + wordNum;
+    _slotList = _rankList + header->rankNum;
+    _imageSize = size;
+    return true;
+}
+
+
+bool TermHash::find(string_view term, uint64_t &termIdx) const {
+    uint64_t hash = hashTerm(term);
+    for (uint64_t level = 0; level < _header->levelNum; level++) {
+        uint64_t levelBegin = _header->levelBeginList[level];
+        uint64_t bitNum = (_header->levelBeginList[level + 1] - levelBegin) * 64;
+        uint64_t bit = levelBegin * 64 + levelPos(hash, level, bitNum);
+        uint64_t word = bit >> 6;
+        uint64_t mask = 1ULL << (bit & 63);
+        if ((_bitList[word] & mask) == 0) {
+            continue;
+        }
+        uint64_t slot = _rankList[word / 8];
+        for (uint64_t w = word & ~7ULL; w < word; w++) {
+            slot += __builtin_popcountll(_bitList[w]);
+        }
+        slot += __builtin_popcountll(_bitList[word] & (mask - 1));
+        uint64_t entry = _slotList[slot];
+        if ((entry >> 32) != fingerprint(hash)) {
+            return false;  // not a term of the vocabulary
+        }
+        termIdx = (uint32_t)entry;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,55 @@
+#ifndef SEARCHSYSTEM_TERMHASH_H
+#define SEARCHSYSTEM_TERMHASH_H
+
+#include "config.h"
+#include "TermDictionary.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+
+// Minimal perfect hash from a term to its index in the TermDictionary, BBHash style.
+//
+// Level l is a bit array of about LEXICON_HASH_GAMMA bits per term still unplaced at that level; a term is
+// placed at the first level where its hash position is not shared with another term. The hash value of a
+// term is the rank of its bit over all levels, and selects a 64-bit slot [32-bit fingerprint][term index].
+// A lookup is one string hash, a few bit probes and one slot read; a term of the vocabulary always
+// finds its slot, any other term is rejected by the fingerprint (false positive rate 2^-32).
+// Like the dictionary, the hash is one 8-byte aligned image, read in place from the mapped lexicon file.
+class TermHash {
+private:
+    static const uint32_t MAX_LEVELS = 32;
+
+    struct TermHashHeader {
+        uint64_t termNum;
+        uint64_t levelNum;  // 0: the build failed, lookups fall back to the dictionary search
+        uint64_t levelBeginList[MAX_LEVELS + 1];  // first word of every level, and the end of the last
+        uint64_t rankNum;  // set bits before every 8-word group
+    };
+
+    const TermHashHeader *_header = nullptr;
+    const uint64_t *_bitList = nullptr;
+    const uint64_t *_rankList = nullptr;
+    const uint64_t *_slotList = nullptr;
+    size_t _imageSize = 0;
+    vector<uint64_t> _image;  // image made by build()
+
+    bool _setImage(const uint8_t *image, size_t size);
+
+public:
+    TermHash();
+    ~TermHash();
+
+    void clear();
+    bool build(const TermDictionary &dictionary);
+    bool open(const uint8_t *image, size_t size);  // no copy, like TermDictionary::open
+
+    const uint8_t *image() const { return reinterpret_cast<const uint8_t *>(_header); }
+    size_t imageSize() const { return _imageSize; }
+    bool ready() const { return _header && _header->levelNum > 0; }
+    uint64_t size() const { return _header ? _header->termNum : 0; }
+    bool find(string_view term, uint64_t &termIdx) const;
+};
+
+#endif //SEARCHSYSTEM_TERMHASH_H
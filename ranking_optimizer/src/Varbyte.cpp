@@ -0,0 +1,207 @@
+#include "Varbyte.h"
+#include <cstring>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>  // SSSE3: _mm_shuffle_epi8
+#endif
+using namespace std;
+
+
+// Function to encode a uint32 value using Varbyte encoding
+vector<uint8_t> varbyteEncode(uint32_t value) {
+    vector<uint8_t> encoded;
+    if (value == 0) {
+        encoded.push_back(0);  // docID 0 starting a chunk still needs one byte
+    }
+    while (value > 0) {
+        // Extract the 7 least significant bits
+        uint8_t byte = value & 0x7F;
+        // Set the high bit to indicate more bytes if needed
+        if (value > 0x7F)
+        {
+            byte |= 0x80;
+        }
+        encoded.push_back(byte);
+        // Shift the value to the right by 7 bits
+        value >>= 7;
+    }
+    return encoded;
+}
+
+
+// Function to decode a Varbyte encoded sequence into a uint32 value
+uint32_t varbyteDecode(const vector<uint8_t> &encoded) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        // Extract the 7 least significant bits from the byte
+        uint32_t byte = encoded[i] & 0x7F;
+        // Add the extracted bits to the result
+        value |= (byte << (7 * i));
+        // If the high bit is not set, it's the last byte
+        if (!(encoded[i] & 0x80)) {
+            break;
+        }
+    }
+    return value;
+}
+
+
+// Plain byte-at-a-time decoder, used for the tail of a chunk and on targets without SIMD
+size_t varbyteDecodeScalar(const uint8_t *in, size_t length, uint32_t *out) {
+    size_t count = 0;
+    uint32_t currentInt = 0;
+    int shift = 0;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = in[i];
+        currentInt |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {  // high bit clear: last byte of this integer
+            out[count++] = currentInt;
+            currentInt = 0;
+            shift = 0;
+        }
+        else {
+            shift += 7;
+        }
+    }
+    return count;
+}
+
+
+#if defined(__SSSE3__)
+
+// One shuffle table entry, keyed on the continuation bits of the next 12 input bytes.
+// Integers of up to 2 bytes are gathered into 16-bit lanes (up to 8 per step),
+// integers of up to 4 bytes into 32-bit lanes (up to 4 per step).
+struct VarbyteShuffle {
+    uint8_t shuffle[16];  // pshufb control, 0x80 clears the lane byte
+    uint8_t intNum;  // integers decoded by this step, 0 means fall back to the scalar decoder
+    uint8_t byteNum;  // input bytes consumed by this step
+    uint8_t wide;  // 0: 16-bit lanes, 1: 32-bit lanes
+};
+
+
+static VarbyteShuffle *buildShuffleTable() {
+    static VarbyteShuffle table[1 << 12];
+    for (uint32_t key = 0; key < (1 << 12); key++) {
+        VarbyteShuffle &entry = table[key];
+        memset(entry.shuffle, 0x80, sizeof(entry.shuffle));
+
+        // Split the 12 bytes into complete integers
+        int lengths[12], starts[12], intCount = 0;
+        int pos = 0;
+        while (pos < 12) {
+            int len = 1;
+            while (pos + len - 1 < 12 && ((key >> (pos + len - 1)) & 1)) {
+                len++;
+            }
+            if (pos + len - 1 >= 12) {
+                break;  // integer continues past the window
+            }
+            starts[intCount] = pos;
+            lengths[intCount++] = len;
+            pos += len;
+        }
+
+        entry.intNum = 0;
+        entry.byteNum = 0;
+        entry.wide = 0;
+        if (intCount == 0 || lengths[0] > 4) {
+            continue;  // 5-byte integers or nothing complete: scalar step
+        }
+
+        int laneBytes = (lengths[0] <= 2) ? 2 : 4;
+        int maxInts = 16 / laneBytes;
+        entry.wide = (laneBytes == 4);
+        for (int i = 0; i < intCount && i < maxInts && lengths[i] <= laneBytes; i++) {
+            for (int b = 0; b < lengths[i]; b++) {
+                entry.shuffle[i * laneBytes + b] = starts[i] + b;
+            }
+            entry.intNum += 1;
+            entry.byteNum += lengths[i];
+        }
+    }
+    return table;
+}
+
+
+static const VarbyteShuffle *shuffleTable = buildShuffleTable();
+
+
+size_t varbyteDecodeSIMD(const uint8_t *in, size_t length, uint32_t *out) {
+    const uint8_t *end = in + length;
+    uint32_t *outBegin = out;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low7 = _mm_set1_epi16(0x007F);
+    const __m128i high7 = _mm_set1_epi16(0x7F00);
+    const __m128i mask7 = _mm_set1_epi32(0x7F);
+
+    while (in + 16 <= end) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+        uint32_t continuation = _mm_movemask_epi8(bytes);
+
+        // Fast path: 16 one-byte integers (small gaps and most frequencies)
+        if (continuation == 0) {
+            __m128i lo16 = _mm_unpacklo_epi8(bytes, zero);
+            __m128i hi16 = _mm_unpackhi_epi8(bytes, zero);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi16(lo16, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4), _mm_unpackhi_epi16(lo16, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 8), _mm_unpacklo_epi16(hi16, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 12), _mm_unpackhi_epi16(hi16, zero));
+            in += 16;
+            out += 16;
+            continue;
+        }
+
+        const VarbyteShuffle &entry = shuffleTable[continuation & 0xFFF];
+        if (entry.intNum == 0) {
+            // Decode one long integer byte by byte
+            size_t len = 1;
+            while ((in[len - 1] & 0x80) && in + len < end) {
+                len++;
+            }
+            out += varbyteDecodeScalar(in, len, out);
+            in += len;
+            continue;
+        }
+
+        __m128i gathered = _mm_shuffle_epi8(bytes, _mm_loadu_si128(reinterpret_cast<const __m128i *>(entry.shuffle)));
+        if (!entry.wide) {
+            // 16-bit lanes: low 7 bits | next 7 bits shifted down over the continuation bit
+            __m128i value = _mm_or_si128(_mm_and_si128(gathered, low7),
+                                         _mm_srli_epi16(_mm_and_si128(gathered, high7), 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi16(value, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4), _mm_unpackhi_epi16(value, zero));
+        }
+        else {
+            // 32-bit lanes: squeeze out the 4 continuation bits
+            __m128i value = _mm_and_si128(gathered, mask7);
+            value = _mm_or_si128(value, _mm_and_si128(_mm_srli_epi32(gathered, 1), _mm_slli_epi32(mask7, 7)));
+            value = _mm_or_si128(value, _mm_and_si128(_mm_srli_epi32(gathered, 2), _mm_slli_epi32(mask7, 14)));
+            value = _mm_or_si128(value, _mm_and_si128(_mm_srli_epi32(gathered, 3), _mm_slli_epi32(mask7, 21)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out), value);
+        }
+        in += entry.byteNum;
+        out += entry.intNum;
+    }
+
+    // Fewer than 16 bytes left: finish with the scalar loop
+    out += varbyteDecodeScalar(in, end - in, out);
+    return out - outBegin;
+}
+
+
+bool varbyteHasSIMD() {
+    return true;
+}
+
+#else
+
+size_t varbyteDecodeSIMD(const uint8_t *in, size_t length, uint32_t *out) {
+    return varbyteDecodeScalar(in, length, out);
+}
+
+
+bool varbyteHasSIMD() {
+    return false;
+}
+
+#endif
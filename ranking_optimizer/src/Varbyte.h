@@ -0,0 +1,22 @@
+#ifndef SEARCHSYSTEM_VARBYTE_H
+#define SEARCHSYSTEM_VARBYTE_H
+
+#include "config.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+using namespace std;
+
+
+// Decoders for the varbyte format written by varbyteEncode: 7 data bits per byte, least significant
+// group first, high bit set on every byte except the last one of an integer.
+// Both decoders write at most `length` integers, so `out` needs room for `length` values.
+
+vector<uint8_t> varbyteEncode(uint32_t value);
+uint32_t varbyteDecode(const vector<uint8_t> &encoded);  // single integer
+
+size_t varbyteDecodeScalar(const uint8_t *in, size_t length, uint32_t *out);  // returns the number of integers
+size_t varbyteDecodeSIMD(const uint8_t *in, size_t length, uint32_t *out);  // Masked-VByte style, scalar fallback
+bool varbyteHasSIMD();  // whether varbyteDecodeSIMD runs vectorized on this build
+
+#endif //SEARCHSYSTEM_VARBYTE_H
@@ -19,6 +19,18 @@ using namespace std;
 #define FINAL_INDEX_PATH "../data/index.idx"
 #define LEXICON_PATH "../data/lexicon.lex"
 #define PAGE_TABLE_PATH "../data/page_table.pt"
+#define DUPLICATE_PATH "../data/duplicates.dup"
+#define DOC_STORE_PATH "../data/documents.ds"
+
+#define CORPUS_FORMAT_TSV 0  // MS MARCO "docID\ttext" with numeric docIDs
+#define CORPUS_FORMAT_BEIR 1  // BEIR corpus.jsonl with string "_id", "title" and "text"
+#define CORPUS_FORMAT CORPUS_FORMAT_TSV
+#define BEIR_DATASET_PATH "../data/beir/scifact/"  // holds corpus.jsonl, queries.jsonl and qrels/
+#define BEIR_CORPUS_PATH BEIR_DATASET_PATH "corpus.jsonl"
+#define BEIR_QUERIES_PATH BEIR_DATASET_PATH "queries.jsonl"
+#define BEIR_QRELS_PATH BEIR_DATASET_PATH "qrels/test.tsv"
+#define BEIR_RUN_PATH "../data/beir_bm25_run.tsv"  // TREC run file, same layout as query_bm25.py output
+#define BEIR_TREC_QRELS_PATH "../data/beir_qrels.tsv"  // qrels converted for trec_eval.py
 
 //#define INDEX_CHUNK (400 * 1024) //400KB
 #define INDEX_BUFFER_SIZE (10 * 1024 * 1024)  // 10 MB
@@ -29,17 +41,54 @@ using namespace std;
 
 #define POSTINGS_PER_CHUNK 64
 #define BLOCK_SIZE (64 * 1024)  // 64 KB
-#define MAX_META_SIZE  8192  // 8 KB
+#define DOC_STORE_MODE 1  // 1: serve result content from the compressed document store, 0: from the collection file
+#define DOC_STORE_BLOCK_SIZE (16 * 1024)  // raw bytes of text per zlib block of the document store
+#define DOC_STORE_CACHE_BLOCKS 64  // decompressed document store blocks kept in memory
+#define LEXICON_BUCKET_SIZE 16  // terms per front-coded bucket of the lexicon, see TermDictionary.h
+#define LEXICON_HASH_GAMMA 2.0  // bits per term in each level of the lexicon's perfect hash, see TermHash.h
 #define MAX_DOC_ID -1
 
 #define FILE_MODE_BIN 1 // 0: ASCII, 1: BIN
+#define INDEX_FORMAT_VERSION 9  // header version of the index, lexicon and page table files, see IndexFormat.h
+#define FORMAT_VERIFY_CHECKSUM 0  // 1: loading also checks the CRC of every section, reading the whole files; 0: header and sizes only
+
+#define CODEC_VARBYTE 0  // one varbyte integer per docID gap / frequency
+#define CODEC_PFOR 1  // bit-packed chunks with PFor exceptions
+#define CODEC_EF 2  // Elias-Fano docID chunks searched in compressed form
+#define CODEC_RAW 3  // uncompressed 32-bit integers
+#define CODEC_BITMAP 4  // docID bitmap over the chunk's range
+#define CODEC_NUM 5  // number of docID codecs, the IDs above; arrays per list codec are sized by it
+#define CODEC_FREQ 16  // frequency chunks only, never a list codec: empty when every frequency is 1, else 2-bit codes with varbyte escapes
+#define CODEC_AUTO 255  // pick the codec of every list at build time
+#define POSTING_CODEC CODEC_AUTO  // chunk codec used when building the index, recorded per list in the lexicon
+#define CODEC_SPEED_WEIGHT 1.0  // bits per posting traded for 1 ns of decoding per posting when picking a codec
+#define ROARING_MODE 1  // dense lists also get Roaring containers, intersected word by word in conjunctive DAAT
+#define ROARING_MIN_DOC_RATIO 16  // a list is dense when it holds at least 1 / ROARING_MIN_DOC_RATIO of the documents
+
+#define BM25_K1 1.2
+#define BM25_B 0.75
+#define BM25_NORM_BYTES 0  // 1: document lengths of the BM25 norms quantized to one byte each, Lucene style (needs an index rebuild)
+#define IMPACT_MODE 0  // 1: postings store quantized BM25 impacts instead of frequencies (needs an index rebuild)
+#define IMPACT_LEVELS 255  // 8-bit impacts, one global scale
 
 #define CONJUNCTIVE 0
 #define DISJUNCTIVE 1
 #define DAAT_FLAG 1 // 0: TAAT, 1: DAAT
+#define DISJUNCTIVE_MAXSCORE 0
+#define DISJUNCTIVE_WAND 1
+#define DISJUNCTIVE_BMW 2  // Block-Max WAND
+#define DISJUNCTIVE_BMM 3  // Block-Max MaxScore, for long queries
+#define DISJUNCTIVE_ALGORITHM DISJUNCTIVE_MAXSCORE  // top-K algorithm of disjunctive DAAT, unless the request picks one
 
 #define NUM_TOP_RESULT 20
 
+#define DEDUP_MODE 0  // 0: off, 1: collapse near-duplicates at query time, 2: drop near-duplicates from postings
+#define SIMHASH_BANDS 4  // LSH bands over the 64-bit SimHash, must be larger than SIMHASH_MAX_DISTANCE
+#define SIMHASH_MAX_DISTANCE 3  // max Hamming distance between near-duplicate fingerprints
+#define SIMHASH_MAX_BUCKET 64  // max comparisons per fingerprint inside one LSH bucket
+#define DEDUP_OVERFETCH 2  // fetch NUM_TOP_RESULT * DEDUP_OVERFETCH candidates before collapsing
+#define NUM_TOP_CANDIDATE (DEDUP_MODE == 1 ? NUM_TOP_RESULT * DEDUP_OVERFETCH : NUM_TOP_RESULT)
+
 #define DEBUG_MODE 1
 #define INDEX_SUBSET 1  // only parse the 1 million subset out of 8.8 millions
 #define RETRIEVE_CONTENT 1  // 0: only retrieve docId, 1: retrieve original content
@@ -53,5 +102,8 @@ using namespace std;
 #define LOAD_FLAG 1  // whether to load lexicon and pagetable into main memory
 #define QUERY_FLAG 1
 #define FRONTEND_FLAG 1  // 0: use console, 1: use Flask web interface
+#define BEIR_RUN_FLAG 0  // whether to run all BEIR test queries and write a TREC run file
+#define BENCHMARK_FLAG 0  // whether to run the index microbenchmarks after loading
+#define BENCHMARK_MIN_SECONDS 1.0  // minimum measuring time of one microbenchmark
 
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "IndexBuilder.h"
 #include "QueryProcessor.h"
+#include "Benchmark.h"
 #include <iostream>
 #include <iomanip>
 #include <string>
@@ -11,6 +12,7 @@ using boost::asio::ip::tcp;
 // Define a global instance of IndexBuilder and QueryProcessor
 IndexBuilder index_builder;
 QueryProcessor query_processor;
+double bm25K1 = BM25_K1, bm25B = BM25_B;  // BM25 parameters of this run, "--k1 <value>" and "--b <value>" on the command line
 
 
 // Function to handle client queries and send responses
@@ -25,16 +27,18 @@ void handleRequest(tcp::socket &socket) {
         string query;
         getline(requestStream, query);
 
-        // Split query and mode
+        // Split query, mode and the optional disjunctive algorithm: "query|mode" or "query|mode|algorithm"
         size_t separator = query.find('|');
         string actualQuery = query.substr(0, separator);
         int queryMode = stoi(query.substr(separator + 1));
+        size_t algorithmSeparator = query.find('|', separator + 1);
+        int algorithm = algorithmSeparator == string::npos ? DISJUNCTIVE_ALGORITHM : stoi(query.substr(algorithmSeparator + 1));
 
         // Output the received query and mode
         cout << "Received query: " << actualQuery << " with mode: " << queryMode << endl;
 
         // Process the query and get the result
-        string result = query_processor.processQuery(actualQuery, queryMode);  // Pass the query mode
+        string result = query_processor.processQuery(actualQuery, queryMode, algorithm);  // Pass the query mode
 
         // Send the query result back to the client
         boost::asio::write(socket, boost::asio::buffer(result + "\n"));
@@ -64,7 +68,12 @@ void startServer(short port) {
 void parseIndex() {
     cout << "Building postings and intermediate inverted index. Timing started... " << endl;
     clock_t index_start = clock();
-    index_builder.readData(DATA_SOURCE_PATH);
+    if (CORPUS_FORMAT == CORPUS_FORMAT_BEIR) {
+        index_builder.readBeirCorpus(BEIR_CORPUS_PATH);
+    }
+    else {
+        index_builder.readData(DATA_SOURCE_PATH);
+    }
     clock_t index_end = clock();
     double index_time = double(index_end - index_start) / 1000000;
     cout << "Building postings and intermediate inverted index DONE." << endl;
@@ -86,7 +95,8 @@ void mergeIndex() {
 void buildLexicon() {
     cout << "Building Lexicon and Final Compressed Index. Timing started..." << endl;
     clock_t lexicon_build_start = clock();
-    index_builder.lexicon.build(MERGED_INDEX_PATH);  // Pass the final merged index file
+    index_builder.pageTable.load(bm25K1, bm25B);  // collection statistics for the index header, document lengths for the BM25 impacts
+    index_builder.lexicon.build(MERGED_INDEX_PATH, index_builder.pageTable);  // Pass the final merged index file
     index_builder.writeLexicon();
     clock_t lexicon_build_end = clock();
     double lexicon_build_time = double(lexicon_build_end - lexicon_build_start) / 1000000;
@@ -99,8 +109,22 @@ void buildLexicon() {
 void load() {
     cout << "Loading PageTable and Lexicon Into Main Memory. Timing Started..." << endl;
     clock_t load_start = clock();
-    query_processor.pageTable.load();
+    query_processor.pageTable.load(bm25K1, bm25B);
     query_processor.lexicon.load();
+    // The index must have been built over the loaded page table
+    if (!checkSource(query_processor.lexicon.indexHeader, query_processor.pageTable.header,
+                     query_processor.lexicon.indexPath, "the page table")) {
+        exit(1);
+    }
+    // Other BM25 parameters than the build's: frequencies are rescored, without the score bounds
+    query_processor.scoreBounds = query_processor.pageTable.checkScoring(query_processor.lexicon.indexHeader,
+                                                                       query_processor.lexicon.indexPath);
+    if (DOC_STORE_MODE) {
+        query_processor.documentStore.load(DOC_STORE_PATH, query_processor.pageTable.header);
+    }
+    if (DEDUP_MODE == 1) {
+        query_processor.duplicateDetector.load();
+    }
     clock_t load_end = clock();
     double load_time = double(load_end - load_start) / 1000000;
     cout << "Loading PageTable and Lexicon Done." << endl;
@@ -115,7 +139,18 @@ void queryLoop() {
 
 
 // Main function still exists for standalone running
-int main() {
+int main(int argc, char *argv[]) {
+    // BM25 parameters: "--k1 <value>" and "--b <value>", BM25_K1 and BM25_B of config.h otherwise
+    for (int i = 1; i < argc; i += 2) {
+        string option = argv[i];
+        char *end = nullptr;
+        double value = i + 1 < argc ? strtod(argv[i + 1], &end) : 0;
+        if ((option != "--k1" && option != "--b") || !end || end == argv[i + 1] || *end != '\0') {
+            cerr << "Usage: " << argv[0] << " [--k1 <value>] [--b <value>]" << endl;
+            return 1;
+        }
+        (option == "--k1" ? bm25K1 : bm25B) = value;
+    }
 
     if (PARSE_INDEX_FLAG) {
         parseIndex();
@@ -133,6 +168,17 @@ int main() {
         load();  // Use the defined load function
     }
 
+    if (BENCHMARK_FLAG) {
+        Benchmark benchmark(query_processor.lexicon);
+        benchmark.varbyteDecode();
+        benchmark.compareCodecs();
+    }
+
+    if (BEIR_RUN_FLAG) {
+        query_processor.runBeirQueries();
+        return 0;
+    }
+
 //    if (QUERY_FLAG) {
 //        queryLoop();  // Use the defined query loop
 //    }